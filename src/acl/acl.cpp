@@ -16,14 +16,9 @@ bool ACL::Evaluate(const ACLInfo& info) const
   for (const Permission& p : perms)
   {
     boost::tribool result = p.Evaluate(info);
-    if (!boost::indeterminate(result))
-    {
-      finalResult.reset(result);
-      return *finalResult;
-    }
+    if (!boost::indeterminate(result)) return static_cast<bool>(result);
   }
-  finalResult.reset(false);
-  return *finalResult;
+  return false;
 }
 
 void ACL::FromStringArg(const std::string& arg)
@@ -49,6 +44,13 @@ void ACL::FromString(const std::string& str)
   std::vector<std::string> args;
   util::Split(args, str, " ", true);
   for (const auto& arg : args) FromStringArg(arg);
+  
+  if (perms.empty()) finalResult.reset(false);
+  else
+  {
+    boost::tribool result = perms.front().Unconditional();
+    if (!boost::indeterminate(result)) finalResult.reset(static_cast<bool>(result));
+  }
 }
 
 } /* acl namespace */
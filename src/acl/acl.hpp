@@ -30,7 +30,10 @@ struct ACLInfo
 class ACL
 {
   boost::ptr_vector<Permission> perms;
-  mutable boost::optional<bool> finalResult;
+  
+  // set when the result doesn't depend on who is evaluated, fixed
+  // at construction so an ACL is safe to share between threads
+  boost::optional<bool> finalResult;
 
   void FromStringArg(const std::string& arg);
   void FromString(const std::string& str);
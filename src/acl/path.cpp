@@ -1,5 +1,8 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/regex.hpp>
+#include <boost/thread/tss.hpp>
+#include <unordered_map>
+#include <atomic>
 #include "acl/path.hpp"
 #include "fs/owner.hpp"
 #include "cfg/get.hpp"
@@ -7,6 +10,7 @@
 #include "acl/user.hpp"
 #include "logs/logs.hpp"
 #include "util/path/status.hpp"
+#include "util/lrucache.hpp"
 
 namespace acl { namespace path
 {
@@ -22,50 +26,80 @@ bool HiddenFile(const fs::VirtualPath& path)
 
   for (auto& hf : cfg::Get().HiddenFiles())
   {
-    if (util::WildcardMatch(hf.Path(), dirname))
-    {
-      for (auto& mask : hf.Masks())
-      {
-        if (util::WildcardMatch(mask, basename)) return true;
-      }
-    }
+    if (hf.IsHidden(dirname, basename)) return true;
   }
   return false;
 }
 
-bool Evaluate(const std::vector<cfg::Right>& rights, 
-              const User& user, const fs::VirtualPath& path)
+// the owner is only read once the rights show it could change the outcome
+
+bool IsOwner(const User& user, const fs::VirtualPath& path)
 {
-  std::string group;
-  bool firstSpecial = true;
-  auto info = user.ACLInfo();
+  return fs::GetOwner(fs::MakeReal(path)).UID() == user.ID();
+}
+
+// rights paths with special vars compiled for the user and config
+// version last evaluated on this thread
 
-  for (const auto& right : rights)
+class BoundRights
+{
+  int version;
+  std::string username;
+  std::string groupname;
+  std::unordered_map<const cfg::Right*, util::WildcardPattern> patterns;
+  
+public:
+  BoundRights() : version(-1) { }
+  
+  void Bind(int version, const std::string& username, const std::string& groupname)
   {
-    if (right.SpecialVar())
-    {
-      std::string specialPath(right.Path());
-      boost::replace_all(specialPath, "[:username:]", user.Name());
-      if (firstSpecial)
-      {
-        if (user.PrimaryGID() != -1)
-        {
-          group = user.PrimaryGroup();
-        }
-        firstSpecial = false;
-      }
-      
-      if (!group.empty())
-        boost::replace_all(specialPath, "[:groupname:]", group);
+    if (version == this->version && username == this->username && 
+        groupname == this->groupname) return;
         
-      if (util::WildcardMatch(specialPath, path.ToString()))
-        return right.ACL().Evaluate(info);
-    }
-    else
-      if (util::WildcardMatch(right.Path(), path.ToString()))
-        return right.ACL().Evaluate(info);
+    this->version = version;
+    this->username = username;
+    this->groupname = groupname;
+    patterns.clear();
   }
-  return false;
+  
+  const util::WildcardPattern& Pattern(const cfg::Right& right)
+  {
+    auto it = patterns.find(&right);
+    if (it != patterns.end()) return it->second;
+
+    std::string specialPath(right.Path());
+    boost::replace_all(specialPath, "[:username:]", username);
+    if (!groupname.empty())
+      boost::replace_all(specialPath, "[:groupname:]", groupname);
+    
+    return patterns.insert(std::make_pair(&right, util::WildcardPattern(specialPath))).first->second;
+  }
+};
+
+boost::thread_specific_ptr<BoundRights> boundRights;
+
+BoundRights& BindRights(const User& user)
+{
+  if (!boundRights.get()) boundRights.reset(new BoundRights());
+  
+  std::string group;
+  if (user.PrimaryGID() != -1) group = user.PrimaryGroup();
+  boundRights->Bind(cfg::Get().Version(), user.Name(), group);
+  return *boundRights;
+}
+
+bool Evaluate(const cfg::Rights& rights, const User& user, const fs::VirtualPath& path)
+{
+  const std::string& pathStr = path.ToString();
+  BoundRights* bound = nullptr;
+  
+  const cfg::Right* right = rights.Find(pathStr, [&](const cfg::Right& right)
+    {
+      if (!bound) bound = &BindRights(user);
+      return bound->Pattern(right).Match(pathStr);
+    });
+
+  return right && right->ACL().Evaluate(user.ACLInfo());
 }
 
 template <Type type>
@@ -106,11 +140,10 @@ private:
 public:
   static util::Error Allowed(const User& user, const fs::VirtualPath& path)
   {
-    fs::Owner owner = GetOwner(fs::MakeReal(path));
-    if (owner.UID() == user.ID() && AllowedOwner(user, path))
+    util::Error e = AllowedOther(user, path);
+    if (!e && AllowedOwner(user, path) && IsOwner(user, path))
       return util::Error::Success();
-    else
-      return AllowedOther(user, path);
+    return e;
   }
 };
 
@@ -137,11 +170,10 @@ private:
 public:
   static util::Error Allowed(const User& user, const fs::VirtualPath& path)
   {
-    fs::Owner owner = GetOwner(fs::MakeReal(path));
-    if (owner.UID() == user.ID() && AllowedOwner(user, path))
+    util::Error e = AllowedOther(user, path);
+    if (!e && AllowedOwner(user, path) && IsOwner(user, path))
       return util::Error::Success();
-    else
-      return AllowedOther(user, path);
+    return e;
   }
 };
 
@@ -163,12 +195,8 @@ struct Traits<Download>
 private:
   static util::Error CheckNoretrieve(const fs::VirtualPath& path)
   {
-    const cfg::Config& config = cfg::Get();
-    for (auto& mask : config.Noretrieve())
-    {
-      if (util::WildcardMatch(mask, path.Basename().ToString()))
-        return util::Error::Failure(EACCES);
-    }
+    if (cfg::Get().IsNoretrieve(path.Basename().ToString()))
+      return util::Error::Failure(EACCES);
     return util::Error::Success();
   }
 
@@ -191,11 +219,10 @@ private:
 public:
   static util::Error Allowed(const User& user, const fs::VirtualPath& path)
   {
-    fs::Owner owner = GetOwner(fs::MakeReal(path));
-    if (owner.UID() == user.ID() && AllowedOwner(user, path))
+    util::Error e = AllowedOther(user, path);
+    if (!e && AllowedOwner(user, path) && IsOwner(user, path))
       return util::Error::Success();
-    else
-      return AllowedOther(user, path);
+    return e;
   }
 };
 
@@ -222,11 +249,10 @@ private:
 public:
   static util::Error Allowed(const User& user, const fs::VirtualPath& path)
   {
-    fs::Owner owner = GetOwner(fs::MakeReal(path));
-    if (owner.UID() == user.ID() && AllowedOwner(user, path))
+    util::Error e = AllowedOther(user, path);
+    if (!e && AllowedOwner(user, path) && IsOwner(user, path))
       return util::Error::Success();
-    else
-      return AllowedOther(user, path);
+    return e;
   }
 };
 
@@ -253,11 +279,10 @@ private:
 public:
   static util::Error Allowed(const User& user, const fs::VirtualPath& path)
   {
-    fs::Owner owner = GetOwner(fs::MakeReal(path));
-    if (owner.UID() == user.ID() && AllowedOwner(user, path))
+    util::Error e = AllowedOther(user, path);
+    if (!e && AllowedOwner(user, path) && IsOwner(user, path))
       return util::Error::Success();
-    else
-      return AllowedOther(user, path);
+    return e;
   }
 };
 
@@ -284,11 +309,10 @@ private:
 public:
   static util::Error Allowed(const User& user, const fs::VirtualPath& path)
   {
-    fs::Owner owner = GetOwner(fs::MakeReal(path));
-    if (owner.UID() == user.ID() && AllowedOwner(user, path))
+    util::Error e = AllowedOther(user, path);
+    if (!e && AllowedOwner(user, path) && IsOwner(user, path))
       return util::Error::Success();
-    else
-      return AllowedOther(user, path);
+    return e;
   }
 };
 
@@ -327,11 +351,10 @@ private:
 public:
   static util::Error Allowed(const User& user, const fs::VirtualPath& path)
   {
-    fs::Owner owner = GetOwner(fs::MakeReal(path));
-    if (owner.UID() == user.ID() && AllowedOwner(user, path))
+    util::Error e = AllowedOther(user, path);
+    if (!e && AllowedOwner(user, path) && IsOwner(user, path))
       return util::Error::Success();
-    else
-      return AllowedOther(user, path);
+    return e;
   }
 };
 
@@ -413,14 +436,131 @@ bool InsideHomeDir(const User& user, const fs::VirtualPath& path)
   else return util::StartsWith(path.ToString(), user.HomeDir() + '/');
 }
 
+namespace
+{
+
+bool OwnerDependent(Type type)
+{
+  switch (type)
+  {
+    case Resume     :
+    case Overwrite  :
+    case Download   :
+    case Rename     :
+    case Filemove   :
+    case Delete     :
+    case Modify     :
+      return true;
+    default         :
+      return false;
+  }
+}
+
+class DecisionCache
+{
+  typedef util::LRUCache<std::string, util::Error> Decisions;
+  
+  acl::UserID uid;
+  int version;
+  unsigned long ownerGeneration;
+  Decisions decisions;
+  Decisions ownerDecisions;
+  
+  static const uint16_t capacity = 4096;
+  
+  Decisions& Select(Type type)
+  {
+    int currentVersion = cfg::Get().Version();
+    if (currentVersion != version)
+    {
+      decisions.Clear();
+      ownerDecisions.Clear();
+      version = currentVersion;
+    }
+    
+    if (!OwnerDependent(type)) return decisions;
+
+    // uploads, chowns etc. anywhere on the site only discard
+    // the decisions that depend on ownership
+    unsigned long currentGeneration = fs::OwnerGeneration();
+    if (currentGeneration != ownerGeneration)
+    {
+      ownerDecisions.Clear();
+      ownerGeneration = currentGeneration;
+    }
+    return ownerDecisions;
+  }
+  
+public:
+  DecisionCache(acl::UserID uid) :
+    uid(uid), version(-1), ownerGeneration(fs::OwnerGeneration()),
+    decisions(capacity), ownerDecisions(capacity)
+  { }
+  
+  acl::UserID UID() const { return uid; }
+  
+  const util::Error* Find(Type type, const std::string& key)
+  {
+    return Select(type).Find(key);
+  }
+  
+  void Insert(Type type, const std::string& key, const util::Error& e)
+  {
+    Select(type).Insert(key, e);
+  }
+};
+
+boost::thread_specific_ptr<DecisionCache> decisionCache;
+std::atomic<unsigned long long> cacheHits(0);
+std::atomic<unsigned long long> cacheMisses(0);
+
 template <Type type>
-util::Error InnerAllowed(const User& user, const fs::VirtualPath& path)
+util::Error Decide(const User& user, const fs::VirtualPath& path)
 { 
   if (!InsideHomeDir(user, path)) return util::Error::Failure(EACCES);
   if (PrivatePath(path, user)) return util::Error::Failure(ENOENT);
   return Traits<type>::Allowed(user, path);
 }
 
+}
+
+void BindCache(acl::UserID uid)
+{
+  decisionCache.reset(new DecisionCache(uid));
+}
+
+unsigned long long CacheHits()
+{
+  return cacheHits;
+}
+
+unsigned long long CacheMisses()
+{
+  return cacheMisses;
+}
+
+template <Type type>
+util::Error InnerAllowed(const User& user, const fs::VirtualPath& path)
+{ 
+  DecisionCache* cache = decisionCache.get();
+  if (!cache || cache->UID() != user.ID()) return Decide<type>(user, path);
+  
+  std::string key(1, static_cast<char>(type));
+  key += path.ToString();
+  
+  const util::Error* cached = cache->Find(type, key);
+  if (cached)
+  {
+    ++cacheHits;
+    return *cached;
+  }
+  
+  ++cacheMisses;
+  util::Error e = Decide<type>(user, path);
+  cache->Insert(type, key, e);
+  return e;
+}
+
 template <Type type>
 util::Error FileAllowed(const User& user, const fs::VirtualPath& path)
 {  
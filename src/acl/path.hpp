@@ -3,6 +3,7 @@
 
 #include <string>
 #include "util/error.hpp"
+#include "acl/types.hpp"
 
 namespace fs
 {
@@ -48,6 +49,14 @@ util::Error DirAllowed(const User& user, const fs::VirtualPath& path);
 
 util::Error Filter(const User& user, const fs::Path& basename);
 
+// cache decisions for uid on the calling thread, discarded when the
+// config is reloaded and calling again discards any existing decisions
+void BindCache(acl::UserID uid);
+
+// reported by SITE METRICS
+unsigned long long CacheHits();
+unsigned long long CacheMisses();
+
 } /* path namespace */
 } /* acl namespace */
 
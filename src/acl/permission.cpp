@@ -20,6 +20,12 @@ boost::tribool FlagPermission::Evaluate(const ACLInfo& info) const
   return boost::indeterminate;
 }
 
+boost::tribool FlagPermission::Unconditional() const
+{
+  if (flags.find('*') != std::string::npos) return !negate;
+  return boost::indeterminate;
+}
+
 boost::tribool UserPermission::Evaluate(const ACLInfo& info) const
 {
   if (info.username == username) return !negate;
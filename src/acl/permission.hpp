@@ -20,6 +20,9 @@ public:
   virtual ~Permission() { }
   virtual Permission* Clone() const = 0;
   virtual boost::tribool Evaluate(const ACLInfo& info) const = 0;
+  
+  // result when it is the same for everyone
+  virtual boost::tribool Unconditional() const { return boost::indeterminate; }
   friend Permission* new_clone(const Permission& other);
 };
 
@@ -34,6 +37,7 @@ public:
     
   FlagPermission* Clone() const { return new FlagPermission(*this); }  
   boost::tribool Evaluate(const ACLInfo& info) const;
+  boost::tribool Unconditional() const;
 };
 
 class UserPermission : public Permission
@@ -601,8 +601,7 @@ void User::SetSectionRatio(const std::string& section, int ratio)
 
 long long User::SectionCredits(const std::string& section) const
 {
-  auto it = data->credits.find(section);
-  return it != data->credits.end() ? it->second : 0;
+  return db->Credits(section);
 }
 
 void User::IncrSectionCredits(const std::string& section, long long kBytes)
@@ -634,14 +633,14 @@ boost::optional<User> User::Load(acl::UserID uid)
 {
   auto data = db::User::Load(uid);
   if (!data) return boost::none;
-  return boost::optional<User>(User(std::move(*data)));
+  return boost::optional<User>(User(acl::UserData(*data)));
 }
 
 boost::optional<User> User::Load(const std::string& name)
 {
   auto data = db::User::Load(name);
   if (!data) return boost::none;
-  return boost::optional<User>(User(std::move(*data)));
+  return boost::optional<User>(User(acl::UserData(*data)));
 }
 
 boost::optional<User> User::Create(const std::string& name, 
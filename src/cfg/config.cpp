@@ -56,6 +56,7 @@ Config::Config(const std::string& configPath, bool tool) :
   currentSection(nullptr),
   port(-1),
   freeSpace(ParseSize("1G")),
+  freeSpaceInterval(10),
   sitenameLong("EBFTPD"),
   sitenameShort("EB"),
   datapath("data"),
@@ -68,6 +69,7 @@ Config::Config(const std::string& configPath, bool tool) :
   siteopLog("siteop", true, true, 0),
   transferLog("transfer", false, false, 0, false, false),
   dlIncomplete(true),
+  idleCommandsList(true),
   totalUsers(-1),
   multiplierMax(10),
   emptyNuke(102400),
@@ -76,6 +78,8 @@ Config::Config(const std::string& configPath, bool tool) :
   epsvFxp(::cfg::EPSVFxp::Allow),
   maximumRatio(10),
   dirSizeDepth(2),
+  dupeCacheSize(ParseSize("16M")),
+  legacyOwner(true),
   asyncCRC(false),
   identLookup(true),
   dnsLookup(true),
@@ -200,6 +204,12 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     ParameterCheck(opt, toks, 1);
     freeSpace = ParseSize(toks[0]);
   }
+  else if (opt == "free_space_interval")
+  {
+    ParameterCheck(opt, toks, 1);
+    freeSpaceInterval = boost::lexical_cast<int>(toks[0]);
+    if (freeSpaceInterval < 1) throw boost::bad_lexical_cast();
+  }
   else if (opt == "total_users")
   {
     ParameterCheck(opt, toks, 1);
@@ -321,13 +331,18 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
   else if (opt == "idle_commands")
   {
     ParameterCheck(opt, toks, 1, -1);
-    idleCommands.insert(idleCommands.end(), toks.begin(), toks.end());
-    for (auto& cmd : idleCommands) util::ToUpper(cmd);
+    for (auto& cmd : toks)
+    {
+      util::ToUpper(cmd);
+      idleCommands.emplace_back(cmd);
+      idleCommandsList.Add(cmd);
+    }
   }
   else if (opt == "noretrieve")
   {
     ParameterCheck(opt, toks, 1, -1);
     noretrieve.insert(noretrieve.end(), toks.begin(), toks.end());
+    for (const auto& mask : toks) noretrieveList.Add(mask);
   }
   else if (opt == "maximum_speed")
   {
@@ -396,122 +411,125 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
   else if (opt == "delete")
   {
     ParameterCheck(opt, toks, 2, -1);
-    delete_.emplace_back(toks);
+    delete_.Add(toks);
   }
   else if (opt == "deleteown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    deleteown.emplace_back(toks);
+    deleteown.Add(toks);
   }
   else if (opt == "overwrite")
   {
     ParameterCheck(opt, toks, 2, -1);
-    overwrite.emplace_back(toks);
+    overwrite.Add(toks);
   }
   else if (opt == "overwriteown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    overwriteown.emplace_back(toks);
+    overwriteown.Add(toks);
   }
   else if (opt == "resume")
   {
     ParameterCheck(opt, toks, 2, -1);
-    resume.emplace_back(toks);
+    resume.Add(toks);
   }
   else if (opt == "resumeown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    resumeown.emplace_back(toks);
+    resumeown.Add(toks);
   }
   else if (opt == "rename")
   {
     ParameterCheck(opt, toks, 2, -1);
-    rename.emplace_back(toks);
+    rename.Add(toks);
   }
   else if (opt == "renameown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    renameown.emplace_back(toks);
+    renameown.Add(toks);
   }
   else if (opt == "filemove")
   {
     ParameterCheck(opt, toks, 2, -1);
-    filemove.emplace_back(toks);
+    filemove.Add(toks);
   }
   else if (opt == "filemoveown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    filemoveown.emplace_back(toks);
+    filemoveown.Add(toks);
   }
   else if (opt == "makedir")
   {
     ParameterCheck(opt, toks, 2, -1);
-    makedir.emplace_back(toks);
+    makedir.Add(toks);
   }
   else if (opt == "upload")
   {
     ParameterCheck(opt, toks, 2, -1);
-    upload.emplace_back(toks);
+    upload.Add(toks);
   }
   else if (opt == "download")
   {
     ParameterCheck(opt, toks, 2, -1);
-    download.emplace_back(toks);
+    download.Add(toks);
   }
   else if (opt == "downloadown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    downloadown.emplace_back(toks);
+    downloadown.Add(toks);
   }
   else if (opt == "modify")
   {
     ParameterCheck(opt, toks, 2, -1);
-    modify.emplace_back(toks);
+    modify.Add(toks);
   }
   else if (opt == "modifyown")
   {
     ParameterCheck(opt, toks, 2, -1);
-    modifyown.emplace_back(toks);
+    modifyown.Add(toks);
   }
   else if (opt == "nuke")
   {
     ParameterCheck(opt, toks, 2, -1);
-    nuke.emplace_back(toks);
+    nuke.Add(toks);
   }
   else if (opt == "event_path")
   {
     ParameterCheck(opt, toks, 1, -1);
     eventpath.insert(eventpath.end(), toks.begin(), toks.end());
+    for (const auto& path : toks) eventpathList.Add(path);
   }
   else if (opt == "dupe_path")
   {
     ParameterCheck(opt, toks, 1, -1);
     dupepath.insert(dupepath.end(), toks.begin(), toks.end());
+    for (const auto& path : toks) dupepathList.Add(path);
   }
   else if (opt == "index_path")
   {
     ParameterCheck(opt, toks, 1, -1);
     indexpath.insert(indexpath.end(), toks.begin(), toks.end());
+    for (const auto& path : toks) indexpathList.Add(path);
   } 
   else if (opt == "hideinwho")
   {
     ParameterCheck(opt, toks, 2, -1);
-    hideinwho.emplace_back(toks);
+    hideinwho.Add(toks);
   }
   else if (opt == "freefile")
   {
     ParameterCheck(opt, toks, 2, -1);
-    freefile.emplace_back(toks);
+    freefile.Add(toks);
   }
   else if (opt == "nostats")
   {
     ParameterCheck(opt, toks, 2, -1);
-    nostats.emplace_back(toks);
+    nostats.Add(toks);
   }
   else if (opt == "hideowner")
   {
     ParameterCheck(opt, toks, 2, -1);
-    hideowner.emplace_back(toks);
+    hideowner.Add(toks);
   }
   else if (opt == "show_diz")
   {
@@ -640,6 +658,16 @@ void Config::ParseGlobal(const std::string& opt, std::vector<std::string>& toks)
     dirSizeDepth = boost::lexical_cast<int>(toks[0]);
     if (dirSizeDepth < 0) throw boost::bad_lexical_cast();
   }
+  else if (opt == "dupe_cache_size")
+  {
+    ParameterCheck(opt, toks, 1);
+    dupeCacheSize = ParseSize(toks[0]);
+  }
+  else if (opt == "legacy_owner")
+  {
+    ParameterCheck(opt, toks, 1);
+    legacyOwner = YesNoToBoolean(toks[0]);
+  }
   else if (opt == "async_crc")
   {
     ParameterCheck(opt, toks, 1);
@@ -707,6 +735,7 @@ void Config::ParseSection(const std::string& opt, std::vector<std::string>& toks
   {
     ParameterCheck(opt, toks, 1, -1);
     currentSection->paths.insert(currentSection->paths.end(), toks.begin(), toks.end());
+    for (const auto& path : toks) currentSection->pathList.Add(path);
   }
   else if (opt == "separate_credits")
   {
@@ -832,17 +861,17 @@ ConfigPtr Config::Load(std::string configPath, bool tool)
 bool Config::IsEventLogged(const std::string& path) const
 {
   if (path.empty()) return false;
-  return util::WildcardMatch(eventpath, path + (path.back() != '/' ? "/" : ""));
+  return eventpathList.Match(path + (path.back() != '/' ? "/" : ""));
 }
 
 bool Config::IsDupeLogged(const std::string& path) const
 {
-  return util::WildcardMatch(dupepath, path + (path.back() != '/' ? "/" : ""));
+  return dupepathList.Match(path + (path.back() != '/' ? "/" : ""));
 }
 
 bool Config::IsIndexed(const std::string& path) const
 {
-  return util::WildcardMatch(indexpath, path + (path.back() != '/' ? "/" : ""));
+  return indexpathList.Match(path + (path.back() != '/' ? "/" : ""));
 }
 
 // end namespace
@@ -51,6 +51,7 @@ class Config
   ::cfg::AsciiDownloads asciiDownloads;
   ::cfg::AsciiUploads asciiUploads;
   long long freeSpace;
+  int freeSpaceInterval;
   std::string sitenameLong;
   std::string sitenameShort;
   std::string loginPrompt;
@@ -86,31 +87,34 @@ class Config
   ::cfg::TransferLog transferLog;
   
   // ind rights
-  std::vector< ::cfg::Right> delete_; // delete is reserved
-  std::vector< ::cfg::Right> deleteown;
-  std::vector< ::cfg::Right> overwrite;
-  std::vector< ::cfg::Right> overwriteown;
-  std::vector< ::cfg::Right> resume;
-  std::vector< ::cfg::Right> resumeown;
-  std::vector< ::cfg::Right> rename;
-  std::vector< ::cfg::Right> renameown;
-  std::vector< ::cfg::Right> filemove;
-  std::vector< ::cfg::Right> filemoveown;
-  std::vector< ::cfg::Right> makedir;
-  std::vector< ::cfg::Right> upload;
-  std::vector< ::cfg::Right> download;
-  std::vector< ::cfg::Right> downloadown;
-  std::vector< ::cfg::Right> nuke;
-  std::vector< ::cfg::Right> hideinwho;
-  std::vector< ::cfg::Right> freefile;
-  std::vector< ::cfg::Right> nostats;
-  std::vector< ::cfg::Right> hideowner;
-  std::vector< ::cfg::Right> modify;
-  std::vector< ::cfg::Right> modifyown;
+  ::cfg::Rights delete_; // delete is reserved
+  ::cfg::Rights deleteown;
+  ::cfg::Rights overwrite;
+  ::cfg::Rights overwriteown;
+  ::cfg::Rights resume;
+  ::cfg::Rights resumeown;
+  ::cfg::Rights rename;
+  ::cfg::Rights renameown;
+  ::cfg::Rights filemove;
+  ::cfg::Rights filemoveown;
+  ::cfg::Rights makedir;
+  ::cfg::Rights upload;
+  ::cfg::Rights download;
+  ::cfg::Rights downloadown;
+  ::cfg::Rights nuke;
+  ::cfg::Rights hideinwho;
+  ::cfg::Rights freefile;
+  ::cfg::Rights nostats;
+  ::cfg::Rights hideowner;
+  ::cfg::Rights modify;
+  ::cfg::Rights modifyown;
 
   std::vector<std::string> eventpath;
   std::vector<std::string> dupepath;
   std::vector<std::string> indexpath;
+  util::WildcardList eventpathList;
+  util::WildcardList dupepathList;
+  util::WildcardList indexpathList;
 
   // end rights
   std::vector< ::cfg::PathFilter> pathFilter;
@@ -122,10 +126,12 @@ class Config
   bool dlIncomplete;
   std::vector< ::cfg::Cscript> cscript;
   std::vector<std::string> idleCommands;
+  util::WildcardList idleCommandsList;
   int totalUsers;
   ::cfg::Lslong lslong;
   std::vector< ::cfg::HiddenFiles> hiddenFiles;
   std::vector<std::string> noretrieve;
+  util::WildcardList noretrieveList;
   int multiplierMax;
   long long emptyNuke;
   std::vector< ::cfg::Creditcheck> creditcheck;
@@ -146,6 +152,8 @@ class Config
   ::cfg::EPSVFxp epsvFxp;
   int maximumRatio;
   int dirSizeDepth;
+  long long dupeCacheSize;
+  bool legacyOwner;
   bool asyncCRC;
   bool identLookup;
   bool dnsLookup;
@@ -192,6 +200,7 @@ public:
   const ::cfg::AsciiDownloads& AsciiDownloads() const { return asciiDownloads; } 
   const ::cfg::AsciiUploads& AsciiUploads() const { return asciiUploads; } 
   long long FreeSpace() const { return freeSpace; }
+  int FreeSpaceInterval() const { return freeSpaceInterval; }
   const std::string& SitenameLong() const { return sitenameLong; }
   const std::string& SitenameShort() const { return sitenameShort; }
   const std::string& LoginPrompt() const { return loginPrompt; }
@@ -232,31 +241,33 @@ public:
   const ::cfg::TransferLog TransferLog() const { return transferLog; }
 
   // rights section
-  const std::vector< ::cfg::Right>& Delete() const { return delete_; } 
-  const std::vector< ::cfg::Right>& Deleteown() const { return deleteown; } 
-  const std::vector< ::cfg::Right>& Overwrite() const { return overwrite; } 
-  const std::vector< ::cfg::Right>& Overwriteown() const { return overwriteown; } 
-  const std::vector< ::cfg::Right>& Resume() const { return resume; } 
-  const std::vector< ::cfg::Right>& Resumeown() const { return resumeown; } 
-  const std::vector< ::cfg::Right>& Rename() const { return rename; } 
-  const std::vector< ::cfg::Right>& Renameown() const { return renameown; } 
-  const std::vector< ::cfg::Right>& Filemove() const { return filemove; } 
-  const std::vector< ::cfg::Right>& Filemoveown() const { return filemoveown; } 
-  const std::vector< ::cfg::Right>& Makedir() const { return makedir; } 
-  const std::vector< ::cfg::Right>& Upload() const { return upload; } 
-  const std::vector< ::cfg::Right>& Download() const { return download; } 
-  const std::vector< ::cfg::Right>& Downloadown() const { return downloadown; } 
-  const std::vector< ::cfg::Right>& Modify() const { return modify; } 
-  const std::vector< ::cfg::Right>& Modifyown() const { return modifyown; } 
-  const std::vector< ::cfg::Right>& Nuke() const { return nuke; } 
-  const std::vector< ::cfg::Right>& Hideinwho() const { return hideinwho; } 
-  const std::vector< ::cfg::Right>& Freefile() const { return freefile; } 
-  const std::vector< ::cfg::Right>& Nostats() const { return nostats; } 
-  const std::vector< ::cfg::Right>& Hideowner() const { return hideowner; } 
+  const ::cfg::Rights& Delete() const { return delete_; } 
+  const ::cfg::Rights& Deleteown() const { return deleteown; } 
+  const ::cfg::Rights& Overwrite() const { return overwrite; } 
+  const ::cfg::Rights& Overwriteown() const { return overwriteown; } 
+  const ::cfg::Rights& Resume() const { return resume; } 
+  const ::cfg::Rights& Resumeown() const { return resumeown; } 
+  const ::cfg::Rights& Rename() const { return rename; } 
+  const ::cfg::Rights& Renameown() const { return renameown; } 
+  const ::cfg::Rights& Filemove() const { return filemove; } 
+  const ::cfg::Rights& Filemoveown() const { return filemoveown; } 
+  const ::cfg::Rights& Makedir() const { return makedir; } 
+  const ::cfg::Rights& Upload() const { return upload; } 
+  const ::cfg::Rights& Download() const { return download; } 
+  const ::cfg::Rights& Downloadown() const { return downloadown; } 
+  const ::cfg::Rights& Modify() const { return modify; } 
+  const ::cfg::Rights& Modifyown() const { return modifyown; } 
+  const ::cfg::Rights& Nuke() const { return nuke; } 
+  const ::cfg::Rights& Hideinwho() const { return hideinwho; } 
+  const ::cfg::Rights& Freefile() const { return freefile; } 
+  const ::cfg::Rights& Nostats() const { return nostats; } 
+  const ::cfg::Rights& Hideowner() const { return hideowner; } 
 
   bool IsEventLogged(const std::string& path) const;
   bool IsDupeLogged(const std::string& path) const;
   bool IsIndexed(const std::string& path) const;
+  bool IsIdleCommand(const std::string& commandLine) const { return idleCommandsList.Match(commandLine); }
+  bool IsNoretrieve(const std::string& basename) const { return noretrieveList.Match(basename); }
   const std::vector<std::string>& Indexed() const { return indexpath; }
 
   const std::vector< ::cfg::PathFilter>& PathFilter() const { return pathFilter; }
@@ -295,6 +306,8 @@ public:
   const acl::ACL& TLSData() const { return tlsData; }
   const acl::ACL& TLSFxp() const { return tlsFxp; }
   int DirSizeDepth() const { return dirSizeDepth; }
+  long long DupeCacheSize() const { return dupeCacheSize; }
+  bool LegacyOwner() const { return legacyOwner; }
   bool AsyncCRC() const { return asyncCRC; }
   bool IdentLookup() const { return identLookup; }
   bool DNSLookup() const { return dnsLookup; }
@@ -13,9 +13,12 @@ namespace cfg
 namespace
 {
 
-boost::thread_specific_ptr<Config> thisThread;
+// every thread shares the same immutable config for a version, each
+// holds its own reference so a reload never changes the config out
+// from under a command in progress
+boost::thread_specific_ptr<std::shared_ptr<const Config>> thisThread;
 std::mutex sharedMutex;
-std::shared_ptr<Config> shared;
+std::shared_ptr<const Config> shared;
 boost::signals2::signal<void()> updated;
 
 }
@@ -32,23 +35,27 @@ void UpdateShared(const std::shared_ptr<Config> newShared)
 
 void UpdateLocal()
 {
-  Config* config = thisThread.get();
+  std::shared_ptr<const Config>* config = thisThread.get();
   std::lock_guard<std::mutex> lock(sharedMutex);
-  if (config && shared->Version() <= config->Version()) return;
-  thisThread.reset(new Config(*shared));
+  if (config)
+  {
+    if (shared->Version() > (*config)->Version()) *config = shared;
+  }
+  else
+    thisThread.reset(new std::shared_ptr<const Config>(shared));
 }
 
 const Config& Get()
 {
   assert(shared.get()); // program must never call Get until a valid config is loaded
-  Config* config = thisThread.get();
+  std::shared_ptr<const Config>* config = thisThread.get();
   if (!config)
   {
     UpdateLocal();
     config = thisThread.get();
     assert(config);
   }
-  return *config;
+  return **config;
 }
 
 void StopStartCheck()
@@ -1,16 +1,11 @@
 #include "cfg/section.hpp"
-#include "util/string.hpp"
 
 namespace cfg
 {
 
 bool Section::IsMatch(const std::string& path) const
 {
-  for (const auto& p : paths)
-  {
-    if (util::WildcardMatch(p, path)) return true;
-  }
-  return false;
+  return pathList.Match(path);
 }
 
 } /* cfg namespace */
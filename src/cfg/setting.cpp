@@ -169,6 +169,18 @@ Right::Right(std::vector<std::string> toks)
                path.find("[:groupname:]") != std::string::npos;
 }
 
+void Rights::Add(const std::vector<std::string>& toks)
+{
+  rights.emplace_back(toks);
+  if (rights.back().SpecialVar())
+    special.emplace_back(rights.size() - 1);
+  else
+  {
+    index.Add(rights.back().Path());
+    indexed.emplace_back(rights.size() - 1);
+  }
+}
+
 PathFilter::PathFilter() :
   regex(new boost::regex("^[[\\]A-Za-z0-9_'()[:space:]][[\\]A-Za-z0-9_.'()[:space:]-]+$")),
   acl("*")
@@ -251,6 +263,8 @@ HiddenFiles::HiddenFiles(std::vector<std::string> toks)
   path = toks[0];
   toks.erase(toks.begin());
   masks = toks;
+  pathPattern = util::WildcardPattern(path);
+  for (const auto& mask : masks) maskList.Add(mask);
 }
 
 Requests::Requests(const std::vector<std::string>& toks)   
@@ -425,7 +439,8 @@ boost::posix_time::seconds IdleTimeout::Timeout() const { return pimpl->timeout;
 CheckScript::CheckScript(const std::vector<std::string>& toks) :
   path(toks[0]), 
   mask(toks.size() == 2 ? toks[1] : "*"), 
-  disabled(toks[0] == "none")
+  disabled(toks[0] == "none"),
+  pattern(mask)
 {
 }
 
@@ -9,6 +9,7 @@
 #include "acl/acl.hpp"
 #include "acl/passwdstrength.hpp"
 #include "acl/ipstrength.hpp"
+#include "util/wildcard.hpp"
 #include "main.hpp"
 
 namespace boost { namespace posix_time
@@ -56,6 +57,40 @@ public:
   bool SpecialVar() const { return specialVar; }
 };
 
+// Rights in config order, those without special vars are indexed by
+// literal path prefix so only rights that can match are tested. 
+// Special var rights are tested in order by the caller after binding.
+
+class Rights
+{
+  std::vector<Right> rights;
+  util::WildcardList index;
+  std::vector<size_t> indexed;
+  std::vector<size_t> special;
+  
+public:
+  void Add(const std::vector<std::string>& toks);
+  
+  template <typename SpecialMatch>
+  const Right* Find(const std::string& path, const SpecialMatch& specialMatch) const
+  {
+    size_t found = index.Find(path);
+    if (found != util::WildcardList::npos) found = indexed[found];
+    
+    for (size_t i : special)
+    {
+      if (i > found) break;
+      if (specialMatch(rights[i])) return &rights[i];
+    }
+    
+    return found != util::WildcardList::npos ? &rights[found] : nullptr;
+  }
+  
+  std::vector<Right>::const_iterator begin() const { return rights.begin(); }
+  std::vector<Right>::const_iterator end() const { return rights.end(); }
+  bool empty() const { return rights.empty(); }
+};
+
 class ACLInt
 {
   int arg;
@@ -255,11 +290,15 @@ class HiddenFiles
 {
   std::string path;
   std::vector<std::string> masks;
+  util::WildcardPattern pathPattern;
+  util::WildcardList maskList;
   
 public:
   HiddenFiles(std::vector<std::string> toks);
   const std::string& Path() const { return path; }
   const std::vector<std::string>& Masks() const { return masks; }
+  bool IsHidden(const std::string& dirname, const std::string& basename) const
+  { return pathPattern.Match(dirname) && maskList.Match(basename); }
 };
 
 class Requests
@@ -406,6 +445,7 @@ class CheckScript
   std::string path;
   std::string mask;
   bool disabled;
+  util::WildcardPattern pattern;
 
 public:
   CheckScript(const std::vector<std::string>& toks);
@@ -413,6 +453,7 @@ public:
   const std::string Path() const { return path; }
   const std::string Mask() const { return mask; }
   bool Disabled() const { return disabled; }
+  bool IsMatch(const std::string& path) const { return pattern.Match(path); }
 };
 
 class Log
@@ -3,9 +3,11 @@
 #include <memory>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
 #include <dirent.h>
 #include <fnmatch.h>
 #include <boost/tokenizer.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include "cmd/dirlist.hpp"
 #include "ftp/client.hpp"
 #include "fs/direnumerator.hpp"
@@ -35,6 +37,8 @@ enum Options
   OptSizeName     = 'z'   // display size and name only
 };
 
+const std::streamoff outputChunkSize = 16384;
+
 }
 
 ListOptions::ListOptions(const std::string& userDefined,
@@ -179,7 +183,11 @@ void DirectoryList::SplitPath(const fs::Path& path, fs::VirtualPath& parent,
 
 void DirectoryList::Readdir(const fs::VirtualPath& path, fs::DirEnumerator& dirEnum) const
 {
-  dirEnum.Readdir(client.User(), path, !options.NoOwners() && !options.SizeName());
+  // short listings only print names, so unless sorting needs them
+  // entries aren't stat'd and owners aren't read
+  bool loadStatus = options.LongFormat() || options.SizeSort() || options.ModTimeSort();
+  bool loadOwners = options.LongFormat() && !options.NoOwners() && !options.SizeName();
+  dirEnum.Readdir(client.User(), path, loadOwners, loadStatus);
 
   if (options.SizeSort())
   {
@@ -208,31 +216,6 @@ void DirectoryList::ListPath(const fs::VirtualPath& path, std::queue<std::string
 {
   if (maxRecursion && depth > maxRecursion) return;
 
-  fs::DirEnumerator dirEnum;
-  try
-  {
-    Readdir(path, dirEnum);
-  }
-  catch (const util::SystemError& e)
-  {
-    // silent failure - gives empty directory list
-    return;
-  }
-  
-
-  std::ostringstream message;
-  if (depth > 1) message << "\r\n";
-  
-  if (!path.IsEmpty() && depth > 1 && (options.Recursive() || !masks.empty()))
-  {
-    message << path << ":\r\n";
-  }
-  
-  if (options.LongFormat())
-  {
-    message << "total " << static_cast<long long>(dirEnum.TotalBytes() / 1024) << "\r\n";
-  }
-  
   std::string mask;
   if (!masks.empty())
   {
@@ -240,112 +223,173 @@ void DirectoryList::ListPath(const fs::VirtualPath& path, std::queue<std::string
     masks.pop();
   }
   
-  if (masks.empty())
+  // only the names of subdirectories to recurse into are kept
+  // once this directory's listing has been sent
+  std::vector<std::string> subdirs;
   {
-    for (const auto& de : dirEnum)
+    fs::DirEnumerator dirEnum;
+    try
+    {
+      Readdir(path, dirEnum);
+    }
+    catch (const util::SystemError& e)
+    {
+      // silent failure - gives empty directory list
+      return;
+    }
+    
+    std::ostringstream message;
+    if (depth > 1) message << "\r\n";
+    
+    if (!path.IsEmpty() && depth > 1 && (options.Recursive() || !masks.empty() || !mask.empty()))
+    {
+      message << path << ":\r\n";
+    }
+    
+    if (options.LongFormat())
+    {
+      message << "total " << static_cast<long long>(dirEnum.TotalBytes() / 1024) << "\r\n";
+    }
+    
+    if (masks.empty())
     {
-      const std::string& pathStr = de.Path().ToString();
-      if (pathStr[0] == '.' && !options.All()) continue;
-      if (!mask.empty() && fnmatch(mask.c_str(), pathStr.c_str(), 0)) continue;
-      
-      if (options.LongFormat())
+      for (const auto& de : dirEnum)
       {
-        if (options.SizeName())
+        const char* name = de.Name();
+        if (name[0] == '.' && !options.All()) continue;
+        if (!mask.empty() && fnmatch(mask.c_str(), name, 0)) continue;
+        
+        if (options.LongFormat())
         {
-          message << std::left << std::setw(10) << de.Status().Size() << ' '
-                  << de.Path();
+          if (options.SizeName())
+          {
+            message << std::left << std::setw(10) << de.Status().Size() << ' '
+                    << name;
+          }
+          else
+          {
+            message << Permissions(de.Status()) << ' '
+                    << std::setw(3) << de.Status().Links() << ' '
+                    << std::left << std::setw(10) 
+                    << UIDToName(de.Owner().UID()) << ' ';
+            
+            if (!options.NoGroup())
+              message << std::left << std::setw(10) 
+                      << GIDToName(de.Owner().GID()) << ' ';
+                    
+            message << std::right << std::setw(10) << de.Status().Size() << ' '
+                    << Timestamp(de.Status()) << ' '
+                    << name;
+          }
+          
+          if (de.Status().IsSymLink())
+          {
+            auto real = fs::MakeReal(path / de.Path());
+            std::string dest;
+            if (util::path::Readlink(real.ToString(), dest))
+            {
+              message << " -> " << dest;
+            }
+          }
+                  
+          if (options.SlashDirs() && de.Status().IsDirectory()) message << '/';
+          message << "\r\n";
         }
         else
         {
-          message << Permissions(de.Status()) << ' '
-                  << std::setw(3) << de.Status().Native().st_nlink << ' '
-                  << std::left << std::setw(10) 
-                  << UIDToName(de.Owner().UID()) << ' ';
-          
-          if (!options.NoGroup())
-            message << std::left << std::setw(10) 
-                    << GIDToName(de.Owner().GID()) << ' ';
-                  
-          message << std::right << std::setw(10) << de.Status().Size() << ' '
-                  << Timestamp(de.Status()) << ' '
-                  << de.Path();
+          message << name << "\r\n";
         }
         
-        if (de.Status().IsSymLink())
+        if (message.tellp() >= outputChunkSize)
         {
-          auto real = fs::MakeReal(path / de.Path());
-          std::string dest;
-          if (util::path::Readlink(real.ToString(), dest))
-          {
-            message << " -> " << dest;
-          }
+          Output(message.str());
+          message.str(std::string());
         }
-                
-        if (options.SlashDirs() && de.Status().IsDirectory()) message << '/';
-        message << "\r\n";
       }
-      else
+    }
+    
+    Output(message.str());
+    
+    if (options.Recursive() || !mask.empty())
+    {
+      for (const auto& de : dirEnum)
       {
-        message << de.Path() << "\r\n";
+        if (!de.Status().IsDirectory() ||
+             de.Status().IsSymLink()) continue;
+             
+        const char* name = de.Name();
+        if (name[0] == '.' && !options.All()) continue;
+        if (!mask.empty() && fnmatch(mask.c_str(), name, 0)) continue;
+        
+        subdirs.emplace_back(name);
       }
     }
   }
   
-  Output(message.str());
-  
-  if (options.Recursive() || !mask.empty())
+  for (const auto& name : subdirs)
   {
-    for (const auto& de : dirEnum)
-    {
-      if (!de.Status().IsDirectory() ||
-           de.Status().IsSymLink()) continue;
-           
-      const std::string& pathStr = de.Path().ToString();      
-      if (pathStr[0] == '.' && !options.All()) continue;
-      if (!mask.empty() && fnmatch(mask.c_str(), pathStr.c_str(), 0)) continue;
-
-      fs::VirtualPath fullPath(path);
-      fullPath /= de.Path();
-   
-      ListPath(fullPath, masks, depth + 1);
-    }
+    fs::VirtualPath fullPath(path);
+    fullPath /= name;
+    ListPath(fullPath, masks, depth + 1);
   }
 }
 
+namespace
+{
+std::atomic<unsigned long long> listings(0);
+std::atomic<unsigned long long> listingMicroseconds(0);
+}
+
 void DirectoryList::Execute()
 {
+  auto start = boost::posix_time::microsec_clock::local_time();
+  
   fs::VirtualPath parent;
   std::queue<std::string> masks;
   SplitPath(path, parent, masks);
   ListPath(parent, masks);
+  
+  listingMicroseconds += (boost::posix_time::microsec_clock::local_time() - start).total_microseconds();
+  ++listings;
+}
+
+unsigned long long DirectoryList::Listings()
+{
+  return listings;
+}
+
+long long DirectoryList::AverageMicroseconds()
+{
+  unsigned long long count = listings;
+  return count ? listingMicroseconds / count : 0;
 }
 
-std::string DirectoryList::Permissions(const util::path::Status& status)
+std::string DirectoryList::Permissions(const fs::EntryStatus& status)
 {
   std::string perms(10, '-');
   
   if (status.IsSymLink()) perms[0] = 'l';
   else if (status.IsDirectory()) perms[0] = 'd';
   
-  const struct stat& native = status.Native();
+  mode_t mode = status.Mode();
   
-  if (native.st_mode & S_IRUSR) perms[1] = 'r';
-  if (native.st_mode & S_IWUSR) perms[2] = 'w';
-  if (native.st_mode & S_IXUSR) perms[3] = 'x';
-  if (native.st_mode & S_IRGRP) perms[4] = 'r';
-  if (native.st_mode & S_IWGRP) perms[5] = 'w';
-  if (native.st_mode & S_IXGRP) perms[6] = 'x';
-  if (native.st_mode & S_IROTH) perms[7] = 'r';
-  if (native.st_mode & S_IWOTH) perms[8] = 'w';
-  if (native.st_mode & S_IXOTH) perms[9] = 'x';
+  if (mode & S_IRUSR) perms[1] = 'r';
+  if (mode & S_IWUSR) perms[2] = 'w';
+  if (mode & S_IXUSR) perms[3] = 'x';
+  if (mode & S_IRGRP) perms[4] = 'r';
+  if (mode & S_IWGRP) perms[5] = 'w';
+  if (mode & S_IXGRP) perms[6] = 'x';
+  if (mode & S_IROTH) perms[7] = 'r';
+  if (mode & S_IWOTH) perms[8] = 'w';
+  if (mode & S_IXOTH) perms[9] = 'x';
   
   return perms;
 }
 
 
-std::string DirectoryList::Timestamp(const util::path::Status& status) const
+std::string DirectoryList::Timestamp(const fs::EntryStatus& status) const
 {
-  time_t modTime = status.Native().st_mtime - status.Native().st_mtime % 60;
+  time_t modTime = status.ModTime() - status.ModTime() % 60;
   auto it = timestampCache.find(modTime);
   if (it != timestampCache.end()) return it->second;
   char buf[13];
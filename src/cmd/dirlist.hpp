@@ -18,12 +18,7 @@ class Writeable;
 namespace fs
 {
 class DirEnumerator;
-}
-
-namespace util { namespace path
-{
-class Status;
-}
+class EntryStatus;
 }
 
 namespace cmd
@@ -84,8 +79,8 @@ class DirectoryList
   static void SplitPath(const fs::Path& path, fs::VirtualPath& parent,
                         std::queue<std::string>& masks);
                         
-  static std::string Permissions(const util::path::Status& status);
-  std::string Timestamp(const util::path::Status& status) const;
+  static std::string Permissions(const fs::EntryStatus& status);
+  std::string Timestamp(const fs::EntryStatus& status) const;
 
 public:
   DirectoryList(ftp::Client& client,
@@ -95,6 +90,11 @@ public:
                 int maxRecursion);
                 
   void Execute();
+  
+  // completed listings and their average time including sending, reported
+  // by SITE METRICS
+  static unsigned long long Listings();
+  static long long AverageMicroseconds();
 };
 
 } /* cmd namespace */
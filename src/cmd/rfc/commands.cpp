@@ -18,6 +18,7 @@
 #include "cmd/util.hpp"
 #include "db/dupe/dupe.hpp"
 #include "db/index/index.hpp"
+#include "db/index/sizeindex.hpp"
 #include "db/stats/stats.hpp"
 #include "exec/check.hpp"
 #include "exec/cscript.hpp"
@@ -118,6 +119,8 @@ void DELECommand::Execute()
     throw cmd::NoPostScriptError();
   }
   
+  db::index::SizeIndex::Get().Changed(path.ToString());
+  
   auto section = cfg::Get().SectionMatch(path.ToString());
   bool nostats = !section || acl::path::FileAllowed<acl::path::Nostats>(client.User(), path);
   if (!nostats)
@@ -710,6 +713,7 @@ void RMDCommand::Execute()
   
   if (config.IsIndexed(path.ToString()))
     db::index::Delete(path.ToString());
+  db::index::SizeIndex::Get().Changed(path.ToString());
   
   if (config.IsEventLogged(path.ToString()))
   {
@@ -778,6 +782,9 @@ void RNTOCommand::Execute()
     throw cmd::NoPostScriptError();
   }
 
+  db::index::SizeIndex::Get().Changed(client.RenameFrom().ToString());
+  db::index::SizeIndex::Get().Changed(path.ToString());
+
   if (isDirectory)
   {
     // this should be changed to a single move action so as to retain the
@@ -1,8 +1,10 @@
 #include <ios>
+#include <memory>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/logic/tribool.hpp>
 #include "cmd/rfc/retr.hpp"
 #include "fs/file.hpp"
+#include "fs/tailwatcher.hpp"
 #include "db/stats/stats.hpp"
 #include "stats/util.hpp"
 #include "util/scopeguard.hpp"
@@ -206,16 +208,28 @@ void RETRCommand::Execute()
                                              data.State().StartTime());
     
     bool dlIncomplete = cfg::Get().DlIncomplete();
+    std::unique_ptr<fs::TailFollower> follower;
+    unsigned long long seen = 0;
+    bool checkIncomplete = true;
     std::vector<char> asciiBuf;
     char buffer[16384];
     
     while (true)
     {
+      if (follower) seen = follower->Sequence();
       std::streamsize len = fin->read(buffer, sizeof(buffer));
       if (len < 0) 
       {
-        if (!dlIncomplete || !fs::IsIncomplete(MakeReal(path))) break;
-        boost::this_thread::sleep(pt::microseconds(10000));
+        // the upload only needs checking on when it may have completed or
+        // gone inactive, not each time it's written to
+        if (!dlIncomplete || (checkIncomplete && !fs::IsIncomplete(MakeReal(path)))) break;
+        if (!follower)
+        {
+          follower.reset(new fs::TailFollower(MakeReal(path)));
+          continue;
+        }
+        
+        checkIncomplete = follower->Wait(seen, pt::seconds(1)) != fs::TailEvent::Grown;
         continue;
       }
       
@@ -2,8 +2,10 @@
 #include <unistd.h>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "cmd/rfc/stor.hpp"
+#include "fs/dircache.hpp"
 #include "fs/file.hpp"
 #include "db/stats/stats.hpp"
+#include "db/index/sizeindex.hpp"
 #include "stats/util.hpp"
 #include "ftp/counter.hpp"
 #include "util/scopeguard.hpp"
@@ -17,6 +19,7 @@
 #include "exec/check.hpp"
 #include "cmd/error.hpp"
 #include "fs/owner.hpp"
+#include "fs/freespace.hpp"
 #include "util/asynccrc32.hpp"
 #include "util/crc32.hpp"
 #include "ftp/error.hpp"
@@ -147,13 +150,14 @@ void STORCommand::Execute()
     throw cmd::NoPostScriptError();
   }
   
+  fs::SpaceReservation reservation;
   fs::FileSinkPtr fout;
   try
   {
     if (data.RestartOffset() > 0)
-      fout = fs::AppendFile(client.User(), path, data.RestartOffset());
+      fout = fs::AppendFile(client.User(), path, data.RestartOffset(), reservation);
     else
-      fout = fs::CreateFile(client.User(), path);
+      fout = fs::CreateFile(client.User(), path, reservation);
   }
   catch (const util::SystemError& e)
   {
@@ -179,6 +183,8 @@ void STORCommand::Execute()
     throw cmd::NoPostScriptError();
   }
 
+  fs::ActiveUpload activeUpload(fs::MakeReal(path));
+  
   bool fileOkay = data.RestartOffset() > 0;
   auto fileGuard = util::MakeScopeExit([&]
   {
@@ -187,6 +193,7 @@ void STORCommand::Execute()
       try
       {
         fs::DeleteFile(fs::MakeReal(path));
+        db::index::SizeIndex::Get().Changed(path.ToString());
       }
       catch (std::exception& e)
       {
@@ -281,6 +288,7 @@ void STORCommand::Execute()
       data.State().Update(len);
       
       fout->write(bufp, len);
+      reservation.Written(len);
       
       if (calcCrc) crc32->Update(reinterpret_cast<uint8_t*>(bufp), len);
       onlineUpdater.Update(data.State().Bytes());
@@ -316,6 +324,7 @@ void STORCommand::Execute()
 
   fout->close();
   data.Close();
+  db::index::SizeIndex::Get().Changed(path.ToString());
   
   e = fs::Chmod(fs::MakeReal(path), completeMode);
   if (!e) control.PartReply(ftp::DataClosedOkay, "Failed to chmod upload: " + e.Message());
@@ -1,49 +1,57 @@
 #include <sstream>
 #include <vector>
 #include <string>
+#include <mutex>
 #include "cmd/site/chown.hpp"
 #include "fs/globiterator.hpp"
 #include "fs/dircontainer.hpp"
+#include "fs/treewalk.hpp"
 #include "cmd/error.hpp"
-#include "util/path/status.hpp"
-#include "util/enumbitwise.hpp"
 #include "util/string.hpp"
 #include "acl/group.hpp"
 #include "acl/user.hpp"
+#include "util/error.hpp"
 
 namespace cmd { namespace site
 {
 
 void CHOWNCommand::Process(fs::VirtualPath pathmask)
 {
-  auto flags = fs::GlobIterator::NoFlags;
-  if (recursive) flags |= fs::GlobIterator::Recursive;
+  std::mutex mutex;
+  std::vector<std::string> failures;
+  
+  auto visit = [&](const fs::WalkEntry& entry)
+  {
+    fs::SetOwner(entry.dirfd, entry.real, owner);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entry.status.IsDirectory()) ++dirs;
+    else ++files;
+  };
+  
+  auto error = [&](const fs::VirtualPath& path, int errno_)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    failures.emplace_back("CHOWN " + path.ToString() + ": " + 
+                          util::Error::Failure(errno_).Message());
+    ++failed;
+  };
   
   try
   {
-    for (auto& entry : fs::GlobContainer(client.User(), pathmask, flags))
+    for (auto& entry : fs::GlobContainer(client.User(), pathmask))
     {
-      fs::VirtualPath entryPath(pathmask.Dirname() / entry);
-      try
-      {
-        util::path::Status status(fs::MakeReal(entryPath).ToString());
-        fs::SetOwner(fs::MakeReal(entryPath), owner);
-        if (status.IsDirectory()) ++dirs;
-        else ++files;
-      }
-      catch (const util::SystemError& e)
-      {
-        ++failed;
-        control.PartReply(ftp::CommandOkay, "CHOWN " + 
-            entryPath.ToString() + ": " + e.Message());        
-      }
+      fs::WalkTree(client.User(), pathmask.Dirname() / entry, recursive, visit, error);
     }
   }
   catch (const util::SystemError& e)
   {
     ++failed;
-    control.PartReply(ftp::CommandOkay, 
-        "CHOWN " + pathmask.ToString() + ": " + e.Message());
+    failures.emplace_back("CHOWN " + pathmask.ToString() + ": " + e.Message());
+  }
+  
+  for (const auto& failure : failures)
+  {
+    control.PartReply(ftp::CommandOkay, failure);
   }
 }
 
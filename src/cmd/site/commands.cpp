@@ -9,6 +9,7 @@
 #include <cassert>
 #include <cctype>
 #include <ctype.h>
+#include <future>
 #include <iomanip>
 #include <map>
 #include <memory>
@@ -32,14 +33,21 @@
 #include "cfg/util.hpp"
 #include "cmd/error.hpp"
 #include "cmd/online.hpp"
+#include "cmd/dirlist.hpp"
 #include "db/dupe/dupe.hpp"
 #include "db/index/index.hpp"
+#include "db/index/sizeindex.hpp"
+#include "db/replicator.hpp"
+#include "db/writequeue.hpp"
 #include "db/stats/protocol.hpp"
 #include "db/stats/stats.hpp"
 #include "db/stats/traffic.hpp"
 #include "db/stats/transfers.hpp"
+#include "db/user/util.hpp"
+#include "fs/dircache.hpp"
 #include "fs/dircontainer.hpp"
 #include "fs/directory.hpp"
+#include "fs/freespace.hpp"
 #include "fs/globiterator.hpp"
 #include "fs/owner.hpp"
 #include "fs/path.hpp"
@@ -394,7 +402,7 @@ void DISKFREECommand::Execute()
   }
   
   unsigned long long bytes;
-  auto e = util::path::FreeDiskSpace(fs::MakeReal(path).ToString(), bytes);
+  auto e = fs::FreeSpaceMonitor::Get().Available(fs::MakeReal(path), bytes);
   if (!e)
   {
     control.Reply(ftp::ActionNotOkay, pathStr + ":" + e.Message());
@@ -996,6 +1004,38 @@ std::string Age(boost::posix_time::time_duration age)
   return util::TrimCopy(os.str());
 }
 
+void METRICSCommand::Execute()
+{
+  const auto& writeQueue = db::WriteQueue::Get();
+  std::ostringstream os;
+  os << "Write queue: " << writeQueue.Depth() << " queued, "
+     << std::fixed << std::setprecision(2) << (writeQueue.FlushLatency() / 1000.0)
+     << "ms last flush, " << writeQueue.Journaled() << " journaled\n";
+  os << "Replication lag: " << db::Replicator::Get().Lag() << "ms\n";
+  
+  unsigned long long hits = fs::ListingCacheHits();
+  unsigned long long lookups = hits + fs::ListingCacheMisses();
+  os << "Listing cache: " << (lookups ? hits * 100.0 / lookups : 0.0) << "% hits of "
+     << lookups << ", " << (fs::ListingCacheBytes() / 1024.0) << "KB used\n";
+  hits = acl::path::CacheHits();
+  lookups = hits + acl::path::CacheMisses();
+  os << "Path permission cache: " << (lookups ? hits * 100.0 / lookups : 0.0) << "% hits of "
+     << lookups << "\n";
+  hits = db::UserCacheHits();
+  lookups = hits + db::UserCacheMisses();
+  os << "User cache: " << (lookups ? hits * 100.0 / lookups : 0.0) << "% hits of "
+     << lookups << "\n";
+  for (const auto& usage : fs::FreeSpaceMonitor::Get().Filesystems())
+  {
+    os << "Free space " << usage.path << ": " << (usage.freeBytes / 1024.0 / 1024.0) 
+       << "MB estimated, " << (usage.reservedBytes / 1024.0 / 1024.0) 
+       << "MB reserved by uploads\n";
+  }
+  os << "LIST: " << DirectoryList::Listings() << " listings, "
+     << (DirectoryList::AverageMicroseconds() / 1000.0) << "ms average";
+  control.Reply(ftp::CommandOkay, os.str());
+}
+
 void NEWCommand::Execute()
 {
   int number = 10;
@@ -1035,13 +1075,9 @@ void NEWCommand::Execute()
   for (const auto& result : results)
   {
     auto real = fs::MakeReal(fs::VirtualPath(result.path));
-    long long kBytes;
-    auto e = fs::DirectorySize(real, cfg::Get().DirSizeDepth(), kBytes);
-    if (e.Errno() == ENOENT)
-    {
-      db::index::Delete(result.path);
-      continue;
-    }
+    long long kBytes = result.kBytes;
+    int files = result.files;
+    if (kBytes < 0 && !db::index::Calculate(result.path, kBytes, files)) continue;
     
     auto owner = fs::GetOwner(real);
     
@@ -1050,7 +1086,8 @@ void NEWCommand::Execute()
     body.RegisterValue("age", Age(now - result.dateTime));
     body.RegisterValue("path", fs::Path(result.path).Basename().ToString());
     body.RegisterValue("section", result.section);
-    body.RegisterSize("size", e ? kBytes : -1);
+    body.RegisterSize("size", kBytes);
+    body.RegisterValue("files", files);
     body.RegisterValue("user", acl::UIDToName(owner.UID()));
     body.RegisterValue("group", acl::GIDToName(owner.GID()));
     os << body.Compile();
@@ -1297,9 +1334,16 @@ void RELOADCommand::Execute()
   else
     os << "\nTemplates reloaded.";
 
+  size_t inconsistent = db::VerifyUserCache();
+  if (inconsistent > 0)
+  {
+    os << "\nUser cache has " << inconsistent << " inconsistencies with the database.";
+    furtherDetails = true;
+  }
+
   if (furtherDetails)
   {
-    os << "\nSee SITE LOGS ERROR for further details.";    
+    os << "\nSee SITE LOGS ERROR and SITE LOGS DB for further details.";    
   }
   
   control.Reply(ftp::CommandOkay, os.str());
@@ -1387,20 +1431,16 @@ void SEARCHCommand::Execute()
     unsigned index = 0;
     for (const auto& result : results)
     {
-      long long kBytes;
-      auto e = fs::DirectorySize(fs::MakeReal(fs::VirtualPath(result.path)),
-                                 cfg::Get().DirSizeDepth(), kBytes);
-      if (e.Errno() == ENOENT)
-      {
-        db::index::Delete(result.path);
-        continue;
-      }
+      long long kBytes = result.kBytes;
+      int files = result.files;
+      if (kBytes < 0 && !db::index::Calculate(result.path, kBytes, files)) continue;
 
       body.RegisterValue("index", ++index);
       body.RegisterValue("datetime", boost::lexical_cast<std::string>(result.dateTime));
       body.RegisterValue("path", result.path);
       body.RegisterValue("section", result.section);
-      body.RegisterSize("size", e ? kBytes : -1);
+      body.RegisterSize("size", kBytes);
+      body.RegisterValue("files", files);
       os << body.Compile();
     }
 
@@ -1566,6 +1606,7 @@ void STATSCommand::Execute()
   os << head.Compile();
   
   std::map< ::stats::Timeframe, std::map< ::stats::Direction, ::stats::Stat>> totals;
+  auto table = db::stats::CalculateSingleUserAll(uid);
   
   text::TemplateSection& body = templ->Body();
   for (const auto& kv : cfg::Get().Sections())
@@ -1578,7 +1619,8 @@ void STATSCommand::Execute()
       {
         std::string prefix = util::EnumToString(tf) + "_" +
                              util::EnumToString(dir) + "_";
-        auto stat = db::stats::CalculateSingleUser(uid, kv.first, tf, dir);
+        auto it = table.find(std::make_tuple(kv.first, tf, dir));
+        auto stat = it != table.end() ? it->second : ::stats::Stat(uid);
         body.RegisterValue(prefix + "files", stat.Files());
         body.RegisterSize(prefix + "size", stat.KBytes());
         body.RegisterSpeed(prefix + "speed", stat.Speed());
@@ -1768,6 +1810,11 @@ void TRAFFICCommand::Execute()
   
   sections.emplace_back("");
 
+  // the two aggregates are independent, run them concurrently
+  auto protocolFuture = std::async(std::launch::async, &db::stats::ProtocolTotalAll);
+  auto transfers = db::stats::TransfersTotalAll();
+  auto protocol = protocolFuture.get();
+
   auto& body = tmpl->Body();
   
   std::ostringstream tos;
@@ -1776,7 +1823,7 @@ void TRAFFICCommand::Execute()
     body.RegisterValue("section", section);
     for (auto tf : ::stats::timeframes)
     {
-      db::stats::Traffic t(db::stats::TransfersTotal(tf, section));
+      const db::stats::Traffic& t = transfers[std::make_pair(tf, section)];
 
       std::string prefix = util::EnumToString(tf) + "_";
       body.RegisterSize(prefix + "send", t.SendKBytes());
@@ -1792,7 +1839,7 @@ void TRAFFICCommand::Execute()
 
   for (auto tf : ::stats::timeframes)
   {
-    db::stats::Traffic t(db::stats::ProtocolTotal(tf));
+    const db::stats::Traffic& t = protocol[tf];
 
     std::string prefix = "protocol_" + util::EnumToString(tf) + "_";
     head.RegisterSize(prefix + "send", t.SendKBytes());
@@ -184,6 +184,15 @@ public:
   void Execute();
 };
 
+class METRICSCommand : public Command
+{
+public:
+  METRICSCommand(ftp::Client& client, const std::string& argStr, const Args& args) :
+    Command(client, client.Control(), client.Data(), argStr, args) { }
+
+  void Execute();
+};
+
 class NEWCommand : public Command
 {
 public:
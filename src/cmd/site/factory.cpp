@@ -299,7 +299,11 @@ Factory::Factory()
     { "SREPLY",     { 0,  1,  "sreply",
                       std::make_shared<Creator<SREPLYCommand>>(),
                       "Syntax: SITE SREPLY [ON|OFF]",
-                      "Turn single line replies on and off" }, }
+                      "Turn single line replies on and off" }, },
+    { "METRICS",    { 0,  0,  "metrics",
+                      std::make_shared<Creator<METRICSCommand>>(),
+                      "Syntax: SITE METRICS",
+                      "Display database queue and cache metrics" }, }
   };
 }
 
@@ -1,16 +1,19 @@
 #include <sstream>
 #include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_set>
 #include "cmd/site/wipe.hpp"
 #include "fs/globiterator.hpp"
 #include "fs/dircontainer.hpp"
+#include "fs/treewalk.hpp"
 #include "fs/directory.hpp"
 #include "fs/file.hpp"
 #include "cmd/error.hpp"
 #include "db/index/index.hpp"
+#include "db/index/sizeindex.hpp"
 #include "acl/path.hpp"
-#include "util/path/status.hpp"
 #include "cfg/get.hpp"
-#include "util/enumbitwise.hpp"
 #include "logs/logs.hpp"
 #include "util/string.hpp"
 #include "acl/user.hpp"
@@ -20,59 +23,88 @@ namespace cmd { namespace site
 
 void WIPECommand::Process(fs::VirtualPath pathmask)
 {
-  auto flags = fs::GlobIterator::NoFlags;
-  if (recursive) flags |= fs::GlobIterator::Recursive;
+  std::mutex mutex;
+  std::vector<std::string> failures;
+  std::vector<std::string> indexed;
+  std::unordered_set<std::string> changedDirs;
+
+  auto fail = [&](const fs::VirtualPath& path, const std::string& message)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    failures.emplace_back("WIPE " + path.ToString() + ": " + message);
+    ++failed;
+  };
   
-  try
+  auto removed = [&](const fs::VirtualPath& path)
+  {
+    // one size index change per directory covers every entry removed from it
+    if (changedDirs.insert(path.Dirname().ToString()).second)
+      db::index::SizeIndex::Get().Changed(path.ToString());
+  };
+  
+  auto visit = [&](const fs::WalkEntry& entry)
   {
-    for (auto& entry : fs::GlobContainer(client.User(), pathmask, flags))
+    if (entry.status.IsDirectory())
     {
-      fs::VirtualPath entryPath(pathmask.Dirname() / entry);
-      try
+      util::Error e = acl::path::DirAllowed<acl::path::Delete>(client.User(), entry.path);
+      if (e) e = fs::RemoveDirectory(entry.dirfd, entry.real);
+      if (!e)
       {
-        util::path::Status status(fs::MakeReal(entryPath).ToString());
-        if (status.IsDirectory())
-        {
-          util::Error e = fs::RemoveDirectory(client.User(), entryPath);
-          if (!e)
-          {
-            control.PartReply(ftp::CommandOkay, "WIPE " + 
-                entryPath.ToString() + ": " + e.Message());
-            ++failed;
-          }
-          else
-          {
-            if (cfg::Get().IsIndexed(entryPath.ToString()))
-              db::index::Delete(entryPath.ToString());
-            ++dirs;
-          }
-        }
-        else
-        {
-          util::Error e = fs::DeleteFile(client.User(), entryPath);
-          if (!e)
-          {
-            control.PartReply(ftp::CommandOkay, "WIPE " +
-                entryPath.ToString() + ": " + e.Message());
-            ++failed;
-          }
-          else
-            ++files;
-        }
+        fail(entry.path, e.Message());
+        return;
       }
-      catch (const util::SystemError& e)
+      
+      std::lock_guard<std::mutex> lock(mutex);
+      if (cfg::Get().IsIndexed(entry.path.ToString()))
+        indexed.emplace_back(entry.path.ToString());
+      removed(entry.path);
+      ++dirs;
+    }
+    else
+    {
+      util::Error e = acl::path::FileAllowed<acl::path::Delete>(client.User(), entry.path);
+      if (!e)
       {
-        ++failed;
-        control.PartReply(ftp::CommandOkay, "CHOWN " + 
-            entryPath.ToString() + ": " + e.Message());        
+        fail(entry.path, e.Message());
+        return;
       }
+      
+      e = fs::DeleteFile(entry.dirfd, entry.real);
+      if (!e)
+      {
+        fail(entry.path, e.Message());
+        return;
+      }
+      
+      std::lock_guard<std::mutex> lock(mutex);
+      removed(entry.path);
+      ++files;
+    }
+  };
+  
+  auto error = [&](const fs::VirtualPath& path, int errno_)
+  {
+    fail(path, util::Error::Failure(errno_).Message());
+  };
+  
+  try
+  {
+    for (auto& entry : fs::GlobContainer(client.User(), pathmask))
+    {
+      fs::WalkTree(client.User(), pathmask.Dirname() / entry, recursive, visit, error);
     }
   }
   catch (const util::SystemError& e)
   {
     ++failed;
-    control.PartReply(ftp::CommandOkay, 
-        "WIPE " + pathmask.ToString() + ": " + e.Message());
+    failures.emplace_back("WIPE " + pathmask.ToString() + ": " + e.Message());
+  }
+  
+  db::index::Delete(indexed);
+
+  for (const auto& failure : failures)
+  {
+    control.PartReply(ftp::CommandOkay, failure);
   }
 }
 
@@ -115,6 +115,33 @@ int Connection::Update(const std::string& collection, const mongo::Query& query,
 }
 
 
+void Connection::Insert(const std::string& collection, const std::vector<mongo::BSONObj>& objs,
+                        int flags)
+{
+  if (!scopedConn || objs.empty()) return;
+  
+  boost::this_thread::disable_interruption noInterrupt;
+  
+  try
+  {
+    scopedConn->conn().insert(Namespace(collection), objs, flags);
+    if (mode != ConnectionMode::Fast)
+    {
+      auto err = GetLastError();
+      if (!err.Okay())
+      {
+        LogLastError("Insert", err, collection, objs.size());
+        if (mode == ConnectionMode::Safe) throw DBWriteError();
+      }
+    }
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Insert", e, collection, objs.size());
+    if (mode == ConnectionMode::Safe) throw DBWriteError();
+  }
+}
+
 int Connection::Remove(const std::string& collection, const mongo::Query& query)
 {
   if (scopedConn)
@@ -59,6 +59,10 @@ public:
     if (scopedConn) scopedConn->done();
   }
   
+  bool Connected() const { return scopedConn.get() != nullptr; }
+  // connection broken since it was made, writes may not have been sent
+  bool Failed() const { return !scopedConn || scopedConn->conn().isFailed(); }
+  
   LastError GetLastError()
   {
     return LastError(scopedConn->conn().getLastErrorDetailed());
@@ -123,6 +127,9 @@ public:
     }
   }
   
+  void Insert(const std::string& collection, const std::vector<mongo::BSONObj>& objs,
+              int flags = 0);
+  
   template <typename T>
   void InsertMulti(const std::string& collection, const std::vector<T>& objects)
   {
@@ -3,6 +3,9 @@
 #include "db/dupe/dupe.hpp"
 #include "db/connection.hpp"
 #include "db/serialization.hpp"
+#include "db/writequeue.hpp"
+#include "db/trigramindex.hpp"
+#include "db/replicator.hpp"
 #include "util/misc.hpp"
 
 namespace db
@@ -28,16 +31,43 @@ template <> dupe::DupeResult Unserialize<dupe::DupeResult>(const mongo::BSONObj&
 namespace dupe
 {
 
+const std::shared_ptr<TrigramIndex>& Trigrams()
+{
+  static std::shared_ptr<TrigramIndex> trigrams(std::make_shared<TrigramIndex>("dupe", "directory"));
+  return trigrams;
+}
+
 void Add(const std::string& directory, const std::string& section)
 {
-  FastConnection conn;
-  conn.Insert("dupe", BSON("directory" << directory << 
-                           "section" << section <<
-                           "nuked" << false));
+  auto id = mongo::OID::gen();
+  WriteQueue::Get().Insert("dupe", BSON("_id" << id <<
+                                        "directory" << directory << 
+                                        "section" << section <<
+                                        "nuked" << false));
+  Trigrams()->Add(id, directory);
+  LogUpdate("dupe", id);
 }
 
 std::vector<DupeResult> Search(const std::vector<std::string>& terms, int limit)
 {
+  std::vector<mongo::BSONObj> objs;
+  if (Trigrams()->Search(terms, limit, false, objs))
+  {
+    std::vector<DupeResult> results;
+    try
+    {
+      for (const auto& obj : objs)
+      {
+        results.emplace_back(Unserialize<DupeResult>(obj));
+      }
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Search unserialize", e);
+    }
+    return results;
+  }
+  
   mongo::BSONObjBuilder bob;
   for (const std::string& term : terms)
   {
@@ -2,12 +2,21 @@
 #define __DB_DUPE_DUPE_HPP
 
 #include <string>
+#include <memory>
 #include <vector>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
-namespace db { namespace dupe
+namespace db
 {
 
+class TrigramIndex;
+
+namespace dupe
+{
+
+// shortlists entries for directory searches, started with the other services
+const std::shared_ptr<TrigramIndex>& Trigrams();
+
 void Add(const std::string& directory, const std::string& section);
 
 struct DupeResult
@@ -8,6 +8,7 @@
 #include "db/connection.hpp"
 #include "db/error.hpp"
 #include "acl/groupdata.hpp"
+#include "db/replicator.hpp"
 
 namespace db
 {
@@ -63,9 +64,7 @@ bool Group::Create()
 
 void Group::UpdateLog() const
 {
-  FastConnection conn;
-  auto entry = BSON("collection" << "groups" << "id" << group.id);
-  conn.Insert("updatelog", entry);
+  LogUpdate("groups", group.id);
 }
 
 
@@ -11,83 +11,89 @@ namespace db
 std::string GroupCache::GIDToName(acl::GroupID gid)
 {
   if (gid == -1) return "NoGroup";
-  std::lock_guard<std::mutex> lock(namesMutex);
-  auto it = names.find(gid);
-  if (it == names.end()) return "unknown";
+  auto current = Current();
+  auto it = current->names.find(gid);
+  if (it == current->names.end()) return "unknown";
   return it->second;
 }
 
 acl::GroupID GroupCache::NameToGID(const std::string& name)
 {
-  std::lock_guard<std::mutex> lock(gidsMutex);
-  auto it = gids.find(name);
-  if (it == gids.end()) return -1;
+  auto current = Current();
+  auto it = current->gids.find(name);
+  if (it == current->gids.end()) return -1;
   return it->second;
 }
 
 bool GroupCache::Replicate(const mongo::BSONElement& id)
 {
-  if (id.type() != 16) return true;
-  acl::GroupID gid = id.Int();
+  return ReplicateBatch({ id });
+}
+
+bool GroupCache::ReplicateBatch(const std::vector<mongo::BSONElement>& ids)
+{
+  mongo::BSONArrayBuilder gidsBab;
+  std::vector<acl::GroupID> replicated;
+  for (const auto& id : ids)
+  {
+    if (id.type() != 16) continue;
+    acl::GroupID gid = id.Int();
+    gidsBab.append(gid);
+    replicated.emplace_back(gid);
+  }
+  
+  if (replicated.empty()) return true;
 
+  std::vector<GroupPair> groups;
   try
   {
     SafeConnection conn;  
     auto fields = BSON("gid" << 1 << "name" << 1);
-    auto data = conn.QueryOne<GroupPair>("groups", QUERY("gid" << gid), &fields);
-    if (data)
-    {
-      // group found, refresh cached data
-      {
-        std::lock_guard<std::mutex> lock(gidsMutex);
-        gids[data->name] = data->gid;
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(namesMutex);
-        names[data->gid] = data->name;
-      }
-    }
-    else
-    {
-      // group not found, must be deleted, remove from cache
-      std::lock(gidsMutex, namesMutex);
-      std::lock_guard<std::mutex> gidsLock(gidsMutex, std::adopt_lock);
-      std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
-      
-      auto it = names.find(gid);
-      if (it != names.end())
-      {
-        gids.erase(it->second);
-        names.erase(it);
-      }
-    }
+    groups = conn.QueryMulti<GroupPair>("groups", QUERY("gid" << BSON("$in" << gidsBab.arr())), 
+                                        0, 0, &fields);
   }
   catch (const DBError&)
   {
     return false;
   }
+
+  std::lock_guard<std::mutex> lock(writeMutex);
+  auto next = std::make_shared<Snapshot>(*Current());
   
+  // groups not found must be deleted, remove from cache
+  for (acl::GroupID gid : replicated)
+  {
+    auto it = next->names.find(gid);
+    if (it != next->names.end())
+    {
+      next->gids.erase(it->second);
+      next->names.erase(it);
+    }
+  }
+  
+  for (const auto& data : groups)
+  {
+    next->gids[data.name] = data.gid;
+    next->names[data.gid] = data.name;
+  }
+  
+  Publish(next);
   return true;
 }
 
 bool GroupCache::Populate()
 {
+  std::lock_guard<std::mutex> lock(writeMutex);
   auto groups = GetGroups();
   
-  std::lock(namesMutex, gidsMutex);
-  std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
-  std::lock_guard<std::mutex> gidsLock(gidsMutex, std::adopt_lock);
-
-  gids.clear();
-  names.clear();
-  
+  auto next = std::make_shared<Snapshot>();
   for (const auto& group : groups)
   {
-    gids[group.name] = group.id;
-    names[group.id] = group.name;
+    next->gids[group.name] = group.id;
+    next->names[group.id] = group.name;
   }
 
+  Publish(next);
   return true;
 }
 
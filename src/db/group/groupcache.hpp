@@ -3,10 +3,13 @@
 
 #include <string>
 #include <unordered_map>
+#include <memory>
 #include <mutex>
+#include <vector>
 #include "acl/types.hpp"
 #include "db/replicable.hpp"
 #include "db/group/groupcachebase.hpp"
+#include "util/published.hpp"
 
 namespace mongo
 {
@@ -20,18 +23,30 @@ class GroupCache :
   public GroupCacheBase,
   public Replicable
 {
-  std::mutex namesMutex;
-  std::unordered_map<acl::GroupID, std::string> names;
-
-  std::mutex gidsMutex;
-  std::unordered_map<std::string, acl::GroupID> gids;
+  // immutable once published, see UserCache
+  struct Snapshot
+  {
+    std::unordered_map<acl::GroupID, std::string> names;
+    std::unordered_map<std::string, acl::GroupID> gids;
+  };
+  
+  util::Published<Snapshot> snapshot;
+  std::mutex writeMutex;
+  
+  std::shared_ptr<const Snapshot> Current() const { return snapshot.Get(); }
+  void Publish(const std::shared_ptr<const Snapshot>& next) { snapshot.Publish(next); }
   
 public:  
-  GroupCache() : Replicable("groups") { }
+  GroupCache() : 
+    Replicable("groups"),
+    snapshot(std::make_shared<Snapshot>())
+  { }
+  
   std::string GIDToName(acl::GroupID gid);
   acl::GroupID NameToGID(const std::string& name);
 
   bool Replicate(const mongo::BSONElement& id);
+  bool ReplicateBatch(const std::vector<mongo::BSONElement>& ids);
   bool Populate();
 };
 
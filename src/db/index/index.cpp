@@ -3,6 +3,9 @@
 #include "db/index/index.hpp"
 #include "util/misc.hpp"
 #include "db/connection.hpp"
+#include "db/writequeue.hpp"
+#include "db/trigramindex.hpp"
+#include "db/replicator.hpp"
 
 namespace db
 {
@@ -13,27 +16,74 @@ template <> index::SearchResult Unserialize<index::SearchResult>(const mongo::BS
   obj.getObjectID(oid);
   return index::SearchResult(obj["path"].String(),
                              obj["section"].String(),
-                             ToPosixTime(oid.OID().asDateT()));
+                             ToPosixTime(oid.OID().asDateT()),
+                             obj.hasField("kbytes") ? obj["kbytes"].numberLong() : -1,
+                             obj.hasField("files") ? obj["files"].numberInt() : -1);
 }
 
 namespace index
 {
 
+const std::shared_ptr<TrigramIndex>& Trigrams()
+{
+  static std::shared_ptr<TrigramIndex> trigrams(std::make_shared<TrigramIndex>("index", "path"));
+  return trigrams;
+}
 
 void Add(const std::string& path, const std::string& section)
 {
-  FastConnection conn;
-  conn.Insert("index", BSON("path" << path << "section" << section));
+  auto id = mongo::OID::gen();
+  WriteQueue::Get().Insert("index", BSON("_id" << id << "path" << path << "section" << section));
+  Trigrams()->Add(id, path);
+  LogUpdate("index", id);
 }
 
 void Delete(const std::string& path)
 {
-  NoErrorConnection conn;
-  conn.Remove("index", QUERY("path" << path));
+  Trigrams()->Remove(path);
+  // queued behind any insert of the same path still waiting to be written
+  WriteQueue::Get().Remove("index", QUERY("path" << path));
+  LogUpdate("index", path);
+}
+
+void Delete(const std::vector<std::string>& paths)
+{
+  if (paths.empty()) return;
+  
+  mongo::BSONArrayBuilder pathsBab;
+  for (const auto& path : paths)
+  {
+    Trigrams()->Remove(path);
+    pathsBab.append(path);
+  }
+  
+  WriteQueue::Get().Remove("index", QUERY("path" << BSON("$in" << pathsBab.arr())));
+  for (const auto& path : paths)
+  {
+    LogUpdate("index", path);
+  }
 }
 
 std::vector<SearchResult> Search(const std::vector<std::string>& terms, int limit)
 {
+  std::vector<mongo::BSONObj> objs;
+  if (Trigrams()->Search(terms, limit, true, objs))
+  {
+    std::vector<SearchResult> results;
+    try
+    {
+      for (const auto& obj : objs)
+      {
+        results.emplace_back(Unserialize<SearchResult>(obj));
+      }
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Search unserialize", e);
+    }
+    return results;
+  }
+  
   mongo::BSONObjBuilder bob;
   for (const std::string& term : terms)
   {
@@ -2,24 +2,38 @@
 #define __DB_INDEX_INDEX_HPP
 
 #include <string>
+#include <memory>
 #include <vector>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
-namespace db { namespace index
+namespace db
 {
 
+class TrigramIndex;
+
+namespace index
+{
+
+// shortlists entries for path searches, started with the other services
+const std::shared_ptr<TrigramIndex>& Trigrams();
+
 void Add(const std::string& path, const std::string& section);
 void Delete(const std::string& path);
+void Delete(const std::vector<std::string>& paths);
 
 struct SearchResult
 {
   std::string path;
   std::string section;
   boost::posix_time::ptime dateTime;
+  long long kBytes; // -1 until the size index has calculated it
+  int files;
   
   SearchResult(const std::string& path, const std::string& section, 
-               const boost::posix_time::ptime& dateTime) :
-    path(path), section(section), dateTime(dateTime)
+               const boost::posix_time::ptime& dateTime,
+               long long kBytes = -1, int files = -1) :
+    path(path), section(section), dateTime(dateTime),
+    kBytes(kBytes), files(files)
   { }
 };
 
@@ -0,0 +1,152 @@
+#include <vector>
+#include "db/index/sizeindex.hpp"
+#include "db/index/index.hpp"
+#include "db/connection.hpp"
+#include "db/serialization.hpp"
+#include "db/writequeue.hpp"
+#include "fs/directory.hpp"
+#include "fs/path.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+#include "util/verify.hpp"
+#include "util/misc.hpp"
+
+namespace db { namespace index
+{
+
+std::unique_ptr<SizeIndex> SizeIndex::instance;
+
+bool Calculate(const std::string& path, long long& kBytes, int& files)
+{
+  auto e = fs::DirectorySize(fs::MakeReal(fs::VirtualPath(path)),
+                             cfg::Get().DirSizeDepth(), kBytes, files);
+  if (e.Errno() == ENOENT)
+  {
+    Delete(path);
+    return false;
+  }
+
+  auto now = ToDateT(boost::posix_time::microsec_clock::universal_time());
+  if (!e)
+  {
+    // still marked as sized so reconciling moves on to other entries
+    kBytes = -1;
+    files = -1;
+    WriteQueue::Get().Update("index", QUERY("path" << path),
+                             BSON("$set" << BSON("sized" << now)));
+    return true;
+  }
+
+  WriteQueue::Get().Update("index", QUERY("path" << path),
+                           BSON("$set" << BSON("kbytes" << kBytes <<
+                                               "files" << files <<
+                                               "sized" << now)));
+  return true;
+}
+
+void SizeIndex::Changed(const std::string& path)
+{
+  // a directory only counts entries up to the size depth below it
+  int depth = cfg::Get().DirSizeDepth();
+  fs::VirtualPath parent(path);
+  std::lock_guard<std::mutex> lock(mutex);
+  for (int i = 0; i < depth; ++i)
+  {
+    parent = parent.Dirname();
+    if (parent.ToString() == "/") break;
+    changed.insert(parent.ToString());
+  }
+}
+
+void SizeIndex::Update()
+{
+  std::unordered_set<std::string> paths;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    paths.swap(changed);
+  }
+
+  if (paths.empty()) return;
+
+  mongo::BSONArrayBuilder pathsBab;
+  for (const auto& path : paths)
+  {
+    pathsBab.append(path);
+  }
+
+  std::vector<mongo::BSONObj> results;
+  {
+    NoErrorConnection conn;
+    auto fields = BSON("path" << 1);
+    results = conn.Query("index", QUERY("path" << BSON("$in" << pathsBab.arr())), 0, 0, &fields);
+  }
+
+  for (const auto& obj : results)
+  {
+    long long kBytes;
+    int files;
+    Calculate(obj["path"].String(), kBytes, files);
+  }
+}
+
+void SizeIndex::Reconcile()
+{
+  std::vector<mongo::BSONObj> results;
+  {
+    // entries never sized sort first
+    NoErrorConnection conn;
+    auto fields = BSON("path" << 1);
+    results = conn.Query("index", mongo::Query().sort("sized", 1), reconcileBatch, 0, &fields);
+  }
+
+  for (const auto& obj : results)
+  {
+    long long kBytes;
+    int files;
+    Calculate(obj["path"].String(), kBytes, files);
+  }
+}
+
+void SizeIndex::Run()
+{
+  util::SetProcessTitle("SIZE INDEX");
+  try
+  {
+    while (true)
+    {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(updateInterval));
+      try
+      {
+        Update();
+        Reconcile();
+      }
+      catch (const std::exception& e)
+      {
+        logs::Error("Unhandled error on size index thread: %1%", e.what());
+      }
+    }
+  }
+  catch (const boost::thread_interrupted&)
+  {
+  }
+}
+
+void SizeIndex::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting size index thread..");
+  thread = boost::thread(&SizeIndex::Run, this);
+}
+
+void SizeIndex::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping size index thread..");
+    thread.interrupt();
+    thread.join();
+  }
+}
+
+} /* index namespace */
+} /* db namespace */
@@ -0,0 +1,57 @@
+#ifndef __DB_INDEX_SIZEINDEX_HPP
+#define __DB_INDEX_SIZEINDEX_HPP
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <boost/thread/thread.hpp>
+
+namespace db { namespace index
+{
+
+// Sizes and file counts of indexed directories are stored on their index
+// entries. Changes made through ebftpd mark the indexed directories above
+// them and those are recalculated shortly after by a background thread,
+// which also works through the least recently calculated entries to
+// repair drift from changes made outside of ebftpd.
+
+class SizeIndex
+{
+  std::mutex mutex;
+  std::unordered_set<std::string> changed;
+  boost::thread thread;
+
+  static std::unique_ptr<SizeIndex> instance;
+  static const int updateInterval = 5000; // milliseconds
+  static const int reconcileBatch = 20;
+
+  SizeIndex() { }
+
+  void Update();
+  void Reconcile();
+  void Run();
+
+public:
+  void Start();
+  void Stop();
+
+  // path is the virtual path of a file or directory that was added,
+  // removed or modified
+  void Changed(const std::string& path);
+
+  static SizeIndex& Get()
+  {
+    if (!instance) instance.reset(new SizeIndex());
+    return *instance;
+  }
+};
+
+// calculates and stores the size of an indexed directory, the entry is
+// removed and false returned if the directory no longer exists
+bool Calculate(const std::string& path, long long& kBytes, int& files);
+
+} /* index namespace */
+} /* db namespace */
+
+#endif
@@ -3,6 +3,10 @@
 #include "db/replicator.hpp"
 #include "db/user/usercache.hpp"
 #include "db/group/groupcache.hpp"
+#include "db/user/creditledger.hpp"
+#include "db/index/index.hpp"
+#include "db/dupe/dupe.hpp"
+#include "db/trigramindex.hpp"
 #include "db/user/util.hpp"
 #include "db/group/util.hpp"
 
@@ -17,8 +21,8 @@ bool CreateUpdateLog()
     mongo::BSONObj info;
     conn.RunCommand(BSON("create" << "updatelog" << 
                          "capped" << true << 
-                         "size" << 102400 << 
-                         "max" << 100), info);
+                         "size" << 1024000 << 
+                         "max" << 10000), info);
     return true;
   }
   catch (const mongo::DBException&)
@@ -39,8 +43,10 @@ bool EnsureIndexes()
     conn.EnsureIndex("groups", BSON("gid" << 1), true);
     conn.EnsureIndex("groups", BSON("name" << 1), true);
     conn.EnsureIndex("index", BSON("path" << 1), true);
+    conn.EnsureIndex("index", BSON("sized" << 1), false);
     conn.EnsureIndex("dupe", BSON("directory" << 1), true);
     conn.EnsureIndex("updatelog", BSON("timestamp" << 1), false);
+    conn.EnsureIndex("updatelog", BSON("op" << 1), false);
     conn.EnsureIndex("transfers", BSON("uid" << 1 << 
                                        "direction" << 1 << 
                                        "section" << 1 << 
@@ -71,6 +77,10 @@ bool RegisterCaches(const std::function<void(acl::UserID)>& userUpdatedCB)
     if (!replicator.Register(groupCache)) return false;
     SetGroupCache(groupCache);
     
+    if (!replicator.Register(CreditLedger::Pointer())) return false;
+    if (!replicator.Register(index::Trigrams())) return false;
+    if (!replicator.Register(dupe::Trigrams())) return false;
+    
     return true;
   }
   catch (const mongo::DBException&)
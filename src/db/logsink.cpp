@@ -1,6 +1,7 @@
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "db/logsink.hpp"
 #include "db/connection.hpp"
+#include "db/writequeue.hpp"
 
 namespace db
 {
@@ -70,9 +71,8 @@ void LogSink::Flush()
   mongo::BSONObjBuilder* bab = buffer.get();
   if (bab)
   {
-    FastConnection conn;
     bab->append("timestamp", ToDateT(boost::posix_time::microsec_clock::local_time()));
-    conn.Insert(collection, bab->obj());
+    WriteQueue::Get().Insert(collection, bab->obj());
     buffer.reset();
   }
 }
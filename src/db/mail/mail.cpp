@@ -2,6 +2,7 @@
 #include "db/mail/mail.hpp"
 #include "db/mail/message.hpp"
 #include "db/connection.hpp"
+#include "db/writequeue.hpp"
 
 namespace db
 {
@@ -94,7 +95,8 @@ int PurgeTrash(acl::UserID recipient)
 
 void LogOffPurgeTrash(acl::UserID recipient)
 {
-  PurgeTrash(recipient);
+  // nothing waits on the result, keep it off the logout path
+  WriteQueue::Get().Remove("mail", QUERY("recipient" << recipient << "status" << "trash"));
 }
 
 void Trash(const Message& message)
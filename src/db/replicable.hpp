@@ -2,6 +2,7 @@
 #define __DB_REPLICABLE_HPP
 
 #include <string>
+#include <vector>
 
 namespace mongo
 {
@@ -22,11 +23,15 @@ class Replicable
 private:
   std::string collection;
   ReplicationState state;
+  bool replicateOwn;
   
 public:
-  Replicable(const std::string& collection) : 
+  // caches that already hold their own changes needn't be told of
+  // updates logged by this process
+  Replicable(const std::string& collection, bool replicateOwn = true) : 
     collection(collection), 
-    state(ReplicationState::Populate)
+    state(ReplicationState::Populate),
+    replicateOwn(replicateOwn)
   {
     (void) state;
   }
@@ -36,7 +41,19 @@ public:
   virtual bool Replicate(const mongo::BSONElement& id) = 0;
   virtual bool Populate() = 0;
   
+  // ids are unique within a batch, override to reload them together
+  virtual bool ReplicateBatch(const std::vector<mongo::BSONElement>& ids)
+  {
+    bool okay = true;
+    for (const auto& id : ids)
+    {
+      if (!Replicate(id)) okay = false;
+    }
+    return okay;
+  }
+  
   const std::string& Collection() const { return collection; }
+  bool ReplicatesOwn() const { return replicateOwn; }
 };
 
 } /* db namespace */
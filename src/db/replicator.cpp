@@ -1,6 +1,8 @@
 #include <mongo/client/dbclient.h>
 #include <boost/optional.hpp>
 #include <list>
+#include <map>
+#include <set>
 #include <csignal>
 #include "db/replicator.hpp"
 #include "logs/logs.hpp"
@@ -8,6 +10,7 @@
 #include "db/error.hpp"
 #include "util/verify.hpp"
 #include "util/misc.hpp"
+#include "db/writequeue.hpp"
 
 namespace db
 {
@@ -15,8 +18,20 @@ namespace db
 namespace
 {
 
+struct ElementLess
+{
+  bool operator()(const mongo::BSONElement& e1, const mongo::BSONElement& e2) const
+  {
+    return e1.woCompare(e2, false) < 0;
+  }
+};
+
 class Tail
 {
+  // AwaitData blocks server side, this only spaces out retries when
+  // the cursor returns immediately
+  static const int pollInterval = 10; // milliseconds
+  
   std::string ns;
   mongo::BSONObj lastObj;
   boost::optional<mongo::BSONElement> lastOID;
@@ -45,8 +60,11 @@ public:
     InitialiseLastOID();
   }
   
-  mongo::BSONObj Next()
+  // blocks until at least one entry is available, then returns
+  // everything else already received in the same batch
+  std::vector<mongo::BSONObj> NextBatch(size_t maximum)
   {
+    std::vector<mongo::BSONObj> batch;
     while (true)
     {
       if (!cursor.get())
@@ -73,7 +91,7 @@ public:
           if (!cursor->more())
           {
             boost::this_thread::restore_interruption restoreInterrupt(noInterrupt);
-            boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+            boost::this_thread::sleep(boost::posix_time::milliseconds(pollInterval));
             if (cursor->isDead())
             {
               cursor.reset();
@@ -84,18 +102,65 @@ public:
           }
         }
         
-        auto entry = cursor->next();
-        SetLastOID(entry);
-        return entry;
+        SetLastOID(cursor->next());
+        batch.emplace_back(lastObj);
+        if (!cursor->moreInCurrentBatch() || batch.size() >= maximum) return batch;
       }
     }
   }
 };
 
+long long NowMillis()
+{
+  namespace pt = boost::posix_time;
+  static const pt::ptime epoch(boost::gregorian::date(1970, 1, 1));
+  return (pt::microsec_clock::universal_time() - epoch).total_milliseconds();
+}
+
+// identifies updatelog entries logged by this process
+const mongo::OID& NodeID()
+{
+  static const mongo::OID nodeId(mongo::OID::gen());
+  return nodeId;
+}
+
 }
 
 std::unique_ptr<Replicator> Replicator::instance;
 
+namespace
+{
+
+// upserted on a unique op id so an entry resent by the write queue isn't
+// logged twice, the _id is left to the database as the tail resumes
+// from the last _id it saw and ids generated on each node aren't ordered
+template <typename T>
+void LogUpdateWithID(const std::string& collection, const T& id)
+{
+  mongo::OID op(mongo::OID::gen());
+  WriteQueue::Get().Update("updatelog", QUERY("op" << op),
+                           BSON("op" << op << "collection" << collection << "id" << id << 
+                                "node" << NodeID() <<
+                                "timestamp" << mongo::Date_t(NowMillis())), true);
+}
+
+}
+
+void LogUpdate(const std::string& collection, int id)
+{
+  LogUpdateWithID(collection, id);
+}
+
+void LogUpdate(const std::string& collection, const mongo::OID& id)
+{
+  LogUpdateWithID(collection, id);
+}
+
+void LogUpdate(const std::string& collection, const std::string& name)
+{
+  LogUpdateWithID(collection, name);
+}
+
 void Replicator::LogFailed(const std::list<std::shared_ptr<Replicable>>& failed)
 {
   std::ostringstream os;
@@ -108,21 +173,40 @@ void Replicator::LogFailed(const std::list<std::shared_ptr<Replicable>>& failed)
   logs::Database(os.str());
 }
 
-void Replicator::Replicate(const mongo::BSONObj& entry)
+void Replicator::Replicate(const std::vector<mongo::BSONObj>& entries)
 {
-  try
+  // coalesce repeated ids so each cache reloads them only once
+  std::map<std::string, std::set<mongo::BSONElement, ElementLess>> ids;
+  std::map<std::string, std::set<mongo::BSONElement, ElementLess>> otherIds;
+  for (const auto& entry : entries)
+  {
+    try
+    {
+      ids[entry["collection"].String()].insert(entry["id"]);
+      auto node = entry["node"];
+      if (node.type() != mongo::jstOID || node.OID() != NodeID())
+        otherIds[entry["collection"].String()].insert(entry["id"]);
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Replicate unserialize", e, entry);
+    }
+  }
+  
+  for (auto& cache : caches)
   {
-    std::string collection = entry["collection"].String();
-    auto id = entry["id"];
-    for (auto& cache : caches)
+    const auto& cacheIds = cache->ReplicatesOwn() ? ids : otherIds;
+    auto it = cacheIds.find(cache->Collection());
+    if (it != cacheIds.end())
     {
-      if (cache->Collection() == collection)
-        cache->Replicate(id);
+      cache->ReplicateBatch(std::vector<mongo::BSONElement>(it->second.begin(), it->second.end()));
     }
   }
-  catch (const mongo::DBException& e)
+  
+  auto timestamp = entries.back()["timestamp"];
+  if (timestamp.type() == mongo::Date)
   {
-    LogException("Replicate unserialize", e, entry);
+    lag = std::max(0LL, NowMillis() - static_cast<long long>(timestamp.Date().millis));
   }
 }
 
@@ -172,8 +256,7 @@ void Replicator::Run()
       Tail tail(dbConfig.Name() + ".updatelog", conn);
       while (true)
       {
-        auto entry = tail.Next();
-        Replicate(entry);
+        Replicate(tail.NextBatch(maximumBatch));
       }
     }
     catch (const mongo::DBException& e)
@@ -6,11 +6,14 @@
 #include <memory>
 #include <boost/thread/thread.hpp>
 #include <mutex>
+#include <string>
+#include <vector>
 #include "db/replicable.hpp"
 
 namespace mongo
 {
 class BSONObj;
+class OID;
 }
 
 namespace db
@@ -20,15 +23,17 @@ class Replicator
 {
   boost::thread thread;
   std::vector<std::shared_ptr<Replicable>> caches;
+  std::atomic<long long> lag;
 
   static std::unique_ptr<Replicator> instance;
   static const int maximumRetries = 20;
+  static const size_t maximumBatch = 1000;
   
-  Replicator() = default;
+  Replicator() : lag(0) { }
   
   void Run();  
   void LogFailed(const std::list<std::shared_ptr<Replicable>>& failed);
-  void Replicate(const mongo::BSONObj& entry);
+  void Replicate(const std::vector<mongo::BSONObj>& entries);
   void Populate();
   
 public:
@@ -36,6 +41,9 @@ public:
   void Stop();
   
   bool Register(const std::shared_ptr<Replicable>& cache);
+  
+  // milliseconds between the last replicated entry being logged and applied
+  long long Lag() const { return lag; }
 
   static Replicator& Get()
   {
@@ -44,6 +52,10 @@ public:
   }  
 };
 
+void LogUpdate(const std::string& collection, int id);
+void LogUpdate(const std::string& collection, const mongo::OID& id);
+void LogUpdate(const std::string& collection, const std::string& name);
+
 } /* db namespace */
 
 #endif
@@ -21,22 +21,37 @@ void ProtocolUpdate(acl::UserID uid, long long sendKBytes, long long receiveKByt
   qbob.append("year", date.Year());
   mongo::Query query(qbob.obj());
   
-  mongo::BSONObj obj = BSON("$inc" << BSON("send kbytes" << sendKBytes) <<
-                            "$inc" << BSON("receive kbytes" << receiveKBytes));
+  mongo::BSONObj obj = BSON("$inc" << BSON("send kbytes" << sendKBytes <<
+                                            "receive kbytes" << receiveKBytes));
+  // an increment resent by the write queue would be counted twice
   NoErrorConnection conn;
   conn.Update("protocol", query, obj, true);
 }
 
-Traffic ProtocolUser(acl::UserID uid, ::stats::Timeframe timeframe)
+std::map< ::stats::Timeframe, Traffic> ProtocolUserAll(acl::UserID uid)
 {
+  mongo::BSONObjBuilder match;
+  if (uid != -1) match.append("uid", uid);
+  
+  mongo::BSONObjBuilder group;
+  group.append("_id", "");
+  for (auto tf : ::stats::timeframes)
+  {
+    std::string prefix = util::EnumToString(tf) + " ";
+    group.append(prefix + "send", SumTimeframe(tf, "send kbytes"));
+    group.append(prefix + "receive", SumTimeframe(tf, "receive kbytes"));
+  }
+  
   mongo::BSONObj cmd = BSON("aggregate" << "protocol" << "pipeline" <<
     BSON_ARRAY(
-      BSON("$match" << Serialize(timeframe)) <<
-      BSON("$group" << 
-        BSON("_id" << (uid == -1 ? "" : "$uid") <<
-          "send total" << BSON("$sum" << "$send kbytes") <<
-          "receive total" << BSON("$sum" << "$receive kbytes")
-        ))));
+      BSON("$match" << match.obj()) <<
+      BSON("$group" << group.obj())));
+  
+  std::map< ::stats::Timeframe, Traffic> totals;
+  for (auto tf : ::stats::timeframes)
+  {
+    totals[tf] = Traffic();
+  }
   
   mongo::BSONObj result;
   NoErrorConnection conn;
@@ -47,22 +62,26 @@ Traffic ProtocolUser(acl::UserID uid, ::stats::Timeframe timeframe)
     {
       try
       {
-        return Traffic(elems[0]["send total"].Long(), 
-                       elems[0]["receive total"].Long());
+        for (auto tf : ::stats::timeframes)
+        {
+          std::string prefix = util::EnumToString(tf) + " ";
+          totals[tf] = Traffic(elems[0][prefix + "send"].numberLong(), 
+                               elems[0][prefix + "receive"].numberLong());
+        }
       }
       catch (const mongo::DBException& e)
       {
-        LogException("Unserialize protocol total", e, result);
+        LogException("Unserialize protocol totals", e, result);
       }
     }
   }
   
-  return Traffic();
+  return totals;
 }
 
-Traffic ProtocolTotal(::stats::Timeframe timeframe)
+std::map< ::stats::Timeframe, Traffic> ProtocolTotalAll()
 {
-  return ProtocolUser(-1, timeframe);
+  return ProtocolUserAll(-1);
 }
 
 } /* stats namespace */
@@ -1,6 +1,7 @@
 #ifndef __DB_STATS_PROTOCOL_HPP
 #define __DB_STATS_PROTOCOL_HPP
 
+#include <map>
 #include "acl/types.hpp"
 
 namespace stats
@@ -14,8 +15,10 @@ namespace db { namespace stats
 class Traffic;
 
 void ProtocolUpdate(acl::UserID uid, long long sendBytes, long long receiveBytes);
-Traffic ProtocolUser(acl::UserID uid, ::stats::Timeframe timeframe);
-Traffic ProtocolTotal(::stats::Timeframe timeframe);
+
+// every timeframe in a single aggregate
+std::map< ::stats::Timeframe, Traffic> ProtocolUserAll(acl::UserID uid);
+std::map< ::stats::Timeframe, Traffic> ProtocolTotalAll();
 
 } /* stats namespace */
 } /* db namespace */
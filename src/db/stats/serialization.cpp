@@ -42,6 +42,25 @@ mongo::BSONObj Serialize(::stats::Timeframe timeframe)
   return bob.obj();
 }
 
+// $group accumulator which only sums documents within the timeframe,
+// allows all timeframes to be calculated in a single pipeline
+mongo::BSONObj SumTimeframe(::stats::Timeframe timeframe, const std::string& field)
+{
+  std::string value = "$" + field;
+  if (timeframe == ::stats::Timeframe::Alltime)
+    return BSON("$sum" << value);
+  
+  mongo::BSONArrayBuilder conditions;
+  mongo::BSONObjIterator it(Serialize(timeframe));
+  while (it.more())
+  {
+    auto elem = it.next();
+    conditions.append(BSON("$eq" << BSON_ARRAY(std::string("$") + elem.fieldName() << elem.Int())));
+  }
+  
+  return BSON("$sum" << BSON("$cond" << BSON_ARRAY(BSON("$and" << conditions.arr()) << value << 0LL)));
+}
+
 ::stats::Stat Unserialize(const mongo::BSONObj& obj)
 {
   try
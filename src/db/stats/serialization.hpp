@@ -1,6 +1,8 @@
 #ifndef __DB_STATS_SERIALIZATION_HPP
 #define __DB_STATS_SERIALIZATION_HPP
 
+#include <string>
+
 namespace mongo
 {
 class BSONObj;
@@ -16,6 +18,7 @@ namespace db { namespace stats
 {
 
 mongo::BSONObj Serialize(::stats::Timeframe timeframe);
+mongo::BSONObj SumTimeframe(::stats::Timeframe timeframe, const std::string& field);
 ::stats::Stat Unserialize(const mongo::BSONObj& obj);
 
 } /* stats namespace */
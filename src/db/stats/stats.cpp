@@ -13,14 +13,14 @@
 #include "stats/stat.hpp"
 #include "db/connection.hpp"
 #include "db/serialization.hpp"
+#include "stats/types.hpp"
 
 namespace db { namespace stats
 {
 
-void Update(const acl::User& user, long long kBytes, long long xfertime, 
+void Update(acl::UserID uid, long long kBytes, long long xfertime, int files,
     const std::string& section, ::stats::Direction direction, bool decrement)
 {
-  int files = 1;
   if (decrement)
   {
     files *= -1;
@@ -30,7 +30,7 @@ void Update(const acl::User& user, long long kBytes, long long xfertime,
 
   ::stats::Date date(cfg::Get().WeekStart() == cfg::WeekStart::Monday);
   mongo::BSONObjBuilder query;
-  query.append("uid", user.ID());
+  query.append("uid", uid);
   query.append("day", date.Day());
   query.append("week", date.Week());
   query.append("month", date.Month());
@@ -38,11 +38,11 @@ void Update(const acl::User& user, long long kBytes, long long xfertime,
   query.append("direction", util::EnumToString(direction));
   query.append("section", section);
 
-  mongo::BSONObj update = BSON(
-    "$inc" << BSON("files" << files) <<
-    "$inc" << BSON("kbytes" << kBytes) <<
-    "$inc" << BSON("xfertime" << xfertime));
+  mongo::BSONObj update = BSON("$inc" << BSON("files" << files << 
+                                               "kbytes" << kBytes << 
+                                               "xfertime" << xfertime));
   
+  // an increment resent by the write queue would be counted twice
   FastConnection conn;
   conn.Update("transfers", query.obj(), update, true);
 }
@@ -96,18 +96,18 @@ void UploadDecr(const acl::User& user, long long kBytes, time_t modTime, const s
   }
 
   assert(!section.empty());
-  Update(user, kBytes, xfertime, section, ::stats::Direction::Upload, true);
-  Update(user, kBytes, xfertime, "", ::stats::Direction::Upload, false);
+  Update(user.ID(), kBytes, xfertime, 1, section, ::stats::Direction::Upload, true);
+  Update(user.ID(), kBytes, xfertime, 1, "", ::stats::Direction::Upload, false);
 }
 
 void Upload(const acl::User& user, long long kBytes, long long xfertime, const std::string& section)
 {
-  Update(user, kBytes, xfertime, section, ::stats::Direction::Upload, false);
+  Update(user.ID(), kBytes, xfertime, 1, section, ::stats::Direction::Upload, false);
 }
 
 void Download(const acl::User& user, long long kBytes, long long xfertime, const std::string& section)
 {
-  Update(user, kBytes, xfertime, section, ::stats::Direction::Download, false);
+  Update(user.ID(), kBytes, xfertime, 1, section, ::stats::Direction::Download, false);
 }
 
 std::vector< ::stats::Stat> RetrieveUsers(
@@ -269,6 +269,58 @@ std::vector< ::stats::Stat> CalculateGroupRanks(
   return users.front();
 }
 
+StatTable CalculateSingleUserAll(acl::UserID uid)
+{
+  mongo::BSONObjBuilder group;
+  group.append("_id", BSON("section" << "$section" << "direction" << "$direction"));
+  for (auto tf : ::stats::timeframes)
+  {
+    std::string prefix = util::EnumToString(tf) + " ";
+    group.append(prefix + "files", SumTimeframe(tf, "files"));
+    group.append(prefix + "kbytes", SumTimeframe(tf, "kbytes"));
+    group.append(prefix + "xfertime", SumTimeframe(tf, "xfertime"));
+  }
+  
+  auto cmd = BSON("aggregate" << "transfers" << "pipeline" <<
+    BSON_ARRAY(
+      BSON("$match" << BSON("uid" << uid)) <<
+      BSON("$group" << group.obj())));
+
+  StatTable table;
+  mongo::BSONObj result;
+  NoErrorConnection conn;
+  if (conn.RunCommand(cmd, result))
+  {
+    try
+    {
+      for (const auto& elem : result["result"].Array())
+      {
+        auto id = elem["_id"].Obj();
+        std::string section = id["section"].String();
+        std::string direction = id["direction"].String();
+        for (auto dir : ::stats::directions)
+        {
+          if (direction != util::EnumToString(dir)) continue;
+          for (auto tf : ::stats::timeframes)
+          {
+            std::string prefix = util::EnumToString(tf) + " ";
+            table[std::make_tuple(section, tf, dir)] = 
+                ::stats::Stat(uid, elem[prefix + "files"].numberInt(),
+                              elem[prefix + "kbytes"].numberLong(),
+                              elem[prefix + "xfertime"].numberLong());
+          }
+        }
+      }
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Unserialize user stats", e, result);
+    }
+  }
+  
+  return table;
+}
+
 ::stats::Stat CalculateSingleGroup(
       acl::GroupID gid, 
       const std::string& section, 
@@ -4,6 +4,8 @@
 #include <ctime>
 #include <string>
 #include <vector>
+#include <map>
+#include <tuple>
 #include "acl/types.hpp"
 
 namespace stats
@@ -49,6 +51,12 @@ std::vector< ::stats::Stat> CalculateGroupRanks(
       ::stats::Timeframe timeframe, 
       ::stats::Direction direction);
 
+typedef std::map<std::tuple<std::string, ::stats::Timeframe, ::stats::Direction>, 
+                 ::stats::Stat> StatTable;
+
+// every section, timeframe and direction in a single aggregate
+StatTable CalculateSingleUserAll(acl::UserID uid);
+
 ::stats::Stat CalculateSingleGroup(
       acl::GroupID gid, 
       const std::string& section, 
@@ -9,30 +9,33 @@
 namespace db { namespace stats
 {
 
-long long TransfersUser(acl::UserID uid, ::stats::Timeframe timeframe, 
-      const std::string& section, ::stats::Direction direction)
+TrafficTable TransfersUserAll(acl::UserID uid)
 {
   mongo::BSONObjBuilder match;
-  match.append("direction", util::EnumToString(direction));
-  if (!section.empty())
-    match.append("section", section);
-  else
+  if (uid != -1) match.append("uid", uid);
+  
+  mongo::BSONObjBuilder group;
+  group.append("_id", BSON("section" << "$section" << "direction" << "$direction"));
+  for (auto tf : ::stats::timeframes)
   {
-    mongo::BSONArrayBuilder sections;
-    for (const auto& kv : cfg::Get().Sections())
-      sections.append(kv.first);
-    match.appendElements(BSON("section" << BSON("$nin" << sections.arr())));
+    group.append(util::EnumToString(tf), SumTimeframe(tf, "kbytes"));
   }
-  match.appendElements(Serialize(timeframe));
   
   mongo::BSONObj cmd = BSON("aggregate" << "transfers" << "pipeline" <<
     BSON_ARRAY(
       BSON("$match" << match.obj()) <<
-      BSON("$group" << 
-        BSON("_id" << (uid == -1 ? "" : "$uid") <<
-          "total" << BSON("$sum" << "$kbytes")
-        ))));
+      BSON("$group" << group.obj())));
   
+  const auto& sections = cfg::Get().Sections();
+  std::map<std::pair< ::stats::Timeframe, std::string>, std::pair<long long, long long>> totals;
+  for (auto tf : ::stats::timeframes)
+  {
+    totals[std::make_pair(tf, std::string(""))];
+    for (const auto& kv : sections)
+    {
+      totals[std::make_pair(tf, kv.first)];
+    }
+  }
   
   mongo::BSONObj result;
   NoErrorConnection conn;
@@ -40,31 +43,41 @@ long long TransfersUser(acl::UserID uid, ::stats::Timeframe timeframe,
   {
     try
     {
-      auto elems = result["result"].Array();
-      if (!elems.empty())
+      for (const auto& elem : result["result"].Array())
       {
-        return elems[0]["total"].Long();
+        auto id = elem["_id"].Obj();
+        std::string section = id["section"].String();
+        if (sections.find(section) == sections.end()) section.clear();
+        
+        bool download = id["direction"].String() == 
+                        util::EnumToString(::stats::Direction::Download);
+        
+        for (auto tf : ::stats::timeframes)
+        {
+          auto& total = totals[std::make_pair(tf, section)];
+          long long kBytes = elem[util::EnumToString(tf)].numberLong();
+          if (download) total.first += kBytes;
+          else total.second += kBytes;
+        }
       }
     }
     catch (const mongo::DBException& e)
     {
-      LogException("Unserialize transfers total", e, result);
+      LogException("Unserialize transfers totals", e, result);
     }
   }
   
-  return 0;
-}
-
-Traffic TransfersUser(acl::UserID uid, ::stats::Timeframe timeframe,
-      const std::string& section)
-{
-  return Traffic(TransfersUser(uid, timeframe, section, ::stats::Direction::Download),
-                 TransfersUser(uid, timeframe, section, ::stats::Direction::Upload));
+  TrafficTable table;
+  for (const auto& kv : totals)
+  {
+    table.insert(std::make_pair(kv.first, Traffic(kv.second.first, kv.second.second, kv.first.second)));
+  }
+  return table;
 }
 
-Traffic TransfersTotal(::stats::Timeframe timeframe, const std::string& section)
+TrafficTable TransfersTotalAll()
 {
-  return TransfersUser(-1, timeframe, section);
+  return TransfersUserAll(-1);
 }
 
 } /* stats namespace */
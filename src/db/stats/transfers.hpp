@@ -1,7 +1,9 @@
 #ifndef __DB_STATS_TRANSFERS_HPP
 #define __DB_STATS_TRANSFERS_HPP
 
+#include <map>
 #include <string>
+#include <utility>
 #include "acl/types.hpp"
 
 namespace stats
@@ -14,8 +16,12 @@ namespace db { namespace stats
 
 class Traffic;
 
-Traffic TransfersUser(acl::UserID uid, ::stats::Timeframe timeframe, const std::string& section);
-Traffic TransfersTotal(::stats::Timeframe timeframe, const std::string& section);
+typedef std::map<std::pair< ::stats::Timeframe, std::string>, Traffic> TrafficTable;
+
+// every timeframe, direction and section in a single aggregate, 
+// non-section transfers are totalled under the empty section
+TrafficTable TransfersUserAll(acl::UserID uid);
+TrafficTable TransfersTotalAll();
 
 } /* stats namespace */
 } /* db namespace */
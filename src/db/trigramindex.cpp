@@ -0,0 +1,515 @@
+#include <algorithm>
+#include <boost/optional.hpp>
+#include "db/trigramindex.hpp"
+#include "db/connection.hpp"
+#include "db/error.hpp"
+#include "db/replicator.hpp"
+#include "util/string.hpp"
+#include "util/verify.hpp"
+#include "util/misc.hpp"
+#include "logs/logs.hpp"
+
+namespace db
+{
+
+namespace
+{
+
+// trigrams of the lowercased string, sorted and without duplicates
+std::vector<uint32_t> Trigrams(const std::string& lower)
+{
+  std::vector<uint32_t> trigrams;
+  if (lower.size() < 3) return trigrams;
+
+  trigrams.reserve(lower.size() - 2);
+  for (std::string::size_type i = 0; i + 2 < lower.size(); ++i)
+  {
+    trigrams.emplace_back(static_cast<uint32_t>(static_cast<unsigned char>(lower[i])) << 16 |
+                          static_cast<uint32_t>(static_cast<unsigned char>(lower[i + 1])) << 8 |
+                          static_cast<uint32_t>(static_cast<unsigned char>(lower[i + 2])));
+  }
+
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+  return trigrams;
+}
+
+}
+
+std::vector<uint32_t> TrigramIndex::Named(const std::string& name) const
+{
+  std::vector<uint32_t> named;
+  auto matches = [&](uint32_t index)
+    {
+      const Entry& entry = entries[index];
+      if (!entry.removed && !names.compare(entry.offset, entry.length, name))
+        named.emplace_back(index);
+    };
+
+  auto trigrams = Trigrams(util::ToLowerCopy(name));
+  if (trigrams.empty())
+  {
+    for (uint32_t index = 0; index < entries.size(); ++index)
+    {
+      matches(index);
+    }
+    return named;
+  }
+
+  // scan the shortest posting list of the name's trigrams
+  const std::vector<uint32_t>* shortest = nullptr;
+  for (uint32_t trigram : trigrams)
+  {
+    auto it = postings.find(trigram);
+    if (it == postings.end()) return named;
+    if (!shortest || it->second.size() < shortest->size()) shortest = &it->second;
+  }
+
+  std::for_each(shortest->begin(), shortest->end(), matches);
+  return named;
+}
+
+// the field is uniquely indexed so a name already indexed is either
+// replaced by a document known to exist or the new one is ignored
+void TrigramIndex::Insert(const mongo::OID& id, const std::string& name, bool replace)
+{
+  auto named = Named(name);
+  if (!named.empty())
+  {
+    if (!replace) return;
+    for (uint32_t index : named)
+    {
+      if (entries[index].id == id) return;
+    }
+    
+    for (uint32_t index : named)
+    {
+      Tombstone(index);
+    }
+    Compact();
+  }
+
+  uint32_t index = entries.size();
+  entries.emplace_back(id, names.size(), name.size());
+  names += name;
+
+  for (uint32_t trigram : Trigrams(util::ToLowerCopy(name)))
+  {
+    postings[trigram].emplace_back(index);
+  }
+}
+
+void TrigramIndex::Tombstone(uint32_t index)
+{
+  entries[index].removed = true;
+  ++tombstones;
+}
+
+// drops the removed entries once they pass a quarter of the live ones,
+// the posting lists stay sorted as the remaining entries keep their order
+void TrigramIndex::Compact()
+{
+  if (tombstones * 4 <= entries.size() - tombstones) return;
+
+  const uint32_t dropped = -1;
+  std::vector<uint32_t> remap(entries.size(), dropped);
+  std::string compactNames;
+  std::vector<Entry> compactEntries;
+  compactEntries.reserve(entries.size() - tombstones);
+  for (uint32_t index = 0; index < entries.size(); ++index)
+  {
+    const Entry& entry = entries[index];
+    if (entry.removed) continue;
+    remap[index] = compactEntries.size();
+    compactEntries.emplace_back(entry.id, compactNames.size(), entry.length);
+    compactNames.append(names, entry.offset, entry.length);
+  }
+
+  for (auto it = postings.begin(); it != postings.end();)
+  {
+    std::vector<uint32_t> list;
+    for (uint32_t index : it->second)
+    {
+      if (remap[index] != dropped) list.emplace_back(remap[index]);
+    }
+
+    if (list.empty()) it = postings.erase(it);
+    else
+    {
+      it->second.swap(list);
+      ++it;
+    }
+  }
+
+  names.swap(compactNames);
+  entries.swap(compactEntries);
+  tombstones = 0;
+}
+
+bool TrigramIndex::Matches(const Entry& entry, const std::vector<std::string>& terms) const
+{
+  std::string lower(names, entry.offset, entry.length);
+  util::ToLower(lower);
+  for (const auto& term : terms)
+  {
+    if (lower.find(term) == std::string::npos) return false;
+  }
+  return true;
+}
+
+bool TrigramIndex::Load()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    names.clear();
+    entries.clear();
+    postings.clear();
+    tombstones = 0;
+    pendingDropped = false;
+  }
+
+  try
+  {
+    auto fields = BSON("_id" << 1 << field << 1);
+    boost::optional<mongo::OID> last;
+    while (true)
+    {
+      mongo::Query query(last ? QUERY("_id" << BSON("$gt" << *last)) : mongo::Query());
+      query.sort("_id", 1);
+
+      std::vector<mongo::BSONObj> results;
+      {
+        SafeConnection conn;
+        results = conn.Query(Collection(), query, loadBatch, 0, &fields);
+      }
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (results.empty())
+      {
+        // additions were lost while loading, start again as they may
+        // have been made after the load passed them
+        if (pendingDropped)
+        {
+          names.clear();
+          entries.clear();
+          postings.clear();
+          tombstones = 0;
+          pendingDropped = false;
+          last.reset();
+          continue;
+        }
+
+        // additions made while loading that the load didn't pick up
+        for (const auto& add : pending)
+        {
+          Insert(add.first, add.second, false);
+        }
+        pending.clear();
+        ready = true;
+        break;
+      }
+
+      for (const auto& obj : results)
+      {
+        last.reset(obj["_id"].OID());
+        if (obj[field].type() == mongo::String)
+        {
+          uint32_t index = entries.size();
+          const std::string& name = obj[field].String();
+          entries.emplace_back(*last, names.size(), name.size());
+          names += name;
+          for (uint32_t trigram : Trigrams(util::ToLowerCopy(name)))
+          {
+            postings[trigram].emplace_back(index);
+          }
+        }
+      }
+    }
+
+    logs::Debug("Loaded %1% %2% entries into search index", entries.size(), Collection());
+    return true;
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Load " + Collection() + " search index", e);
+  }
+  catch (const DBError&)
+  {
+  }
+
+  return false;
+}
+
+void TrigramIndex::Run()
+{
+  util::SetProcessTitle("SEARCH INDEX");
+  try
+  {
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!loadRequested) loadCondition.wait(lock);
+        loadRequested = false;
+        ready = false;
+      }
+
+      int retryInterval = minimumRetryInterval;
+      while (!Load())
+      {
+        logs::Database("Unable to load %1% search index, retrying in %2% seconds.",
+                       Collection(), retryInterval);
+        boost::this_thread::sleep(boost::posix_time::seconds(retryInterval));
+        retryInterval *= 2;
+        if (retryInterval > maximumRetryInterval) retryInterval = maximumRetryInterval;
+      }
+    }
+  }
+  catch (const boost::thread_interrupted&)
+  {
+  }
+}
+
+void TrigramIndex::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting %1% search index thread..", Collection());
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    loadRequested = true;
+  }
+  thread = boost::thread(&TrigramIndex::Run, this);
+}
+
+void TrigramIndex::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping %1% search index thread..", Collection());
+    thread.interrupt();
+    thread.join();
+  }
+}
+
+void TrigramIndex::Pend(const mongo::OID& id, const std::string& name)
+{
+  // the load is restarted rather than holding on to an unbounded
+  // number of additions while the database is unavailable
+  if (pending.size() >= maximumPending)
+  {
+    pending.clear();
+    pendingDropped = true;
+  }
+
+  pending.emplace_back(id, name);
+}
+
+void TrigramIndex::Add(const mongo::OID& id, const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (ready)
+  {
+    Insert(id, name, false);
+    return;
+  }
+
+  Pend(id, name);
+}
+
+void TrigramIndex::Remove(const std::string& name)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  pending.erase(std::remove_if(pending.begin(), pending.end(),
+                  [&](const std::pair<mongo::OID, std::string>& add)
+                  { return add.second == name; }), pending.end());
+
+  for (uint32_t index : Named(name))
+  {
+    Tombstone(index);
+  }
+  Compact();
+}
+
+bool TrigramIndex::Find(const std::vector<std::string>& terms, int limit, bool newestFirst,
+                        std::vector<mongo::OID>& ids) const
+{
+  if (!ready) return false;
+
+  std::vector<std::string> lowerTerms;
+  std::vector<uint32_t> trigrams;
+  for (const auto& term : terms)
+  {
+    lowerTerms.emplace_back(util::ToLowerCopy(term));
+    auto termTrigrams = Trigrams(lowerTerms.back());
+    trigrams.insert(trigrams.end(), termTrigrams.begin(), termTrigrams.end());
+  }
+
+  if (trigrams.empty()) return false;
+  std::sort(trigrams.begin(), trigrams.end());
+  trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!ready) return false;
+
+  // intersect from the shortest posting list up
+  std::vector<const std::vector<uint32_t>*> lists;
+  for (uint32_t trigram : trigrams)
+  {
+    auto it = postings.find(trigram);
+    if (it == postings.end()) return true;
+    lists.emplace_back(&it->second);
+  }
+
+  std::sort(lists.begin(), lists.end(),
+            [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b)
+            { return a->size() < b->size(); });
+
+  std::vector<uint32_t> candidates(*lists.front());
+  for (auto it = lists.begin() + 1; it != lists.end() && !candidates.empty(); ++it)
+  {
+    std::vector<uint32_t> intersection;
+    std::set_intersection(candidates.begin(), candidates.end(),
+                          (*it)->begin(), (*it)->end(),
+                          std::back_inserter(intersection));
+    candidates.swap(intersection);
+  }
+
+  if (newestFirst) std::reverse(candidates.begin(), candidates.end());
+  for (uint32_t index : candidates)
+  {
+    const Entry& entry = entries[index];
+    if (entry.removed || !Matches(entry, lowerTerms)) continue;
+    ids.emplace_back(entry.id);
+    if (limit > 0 && ids.size() >= static_cast<size_t>(limit)) break;
+  }
+
+  return true;
+}
+
+bool TrigramIndex::Search(const std::vector<std::string>& terms, int limit, bool newestFirst,
+                          std::vector<mongo::BSONObj>& results) const
+{
+  // ids of inserts that are yet to be made or that failed may be among
+  // those found, more are fetched until the limit is made up
+  int fetch = limit;
+  std::vector<mongo::OID> ids;
+  while (Find(terms, fetch, newestFirst, ids))
+  {
+    if (ids.empty()) return true;
+
+    mongo::BSONArrayBuilder idsBab;
+    for (const auto& id : ids)
+    {
+      idsBab.append(id);
+    }
+
+    try
+    {
+      SafeConnection conn;
+      results = conn.Query(Collection(), QUERY("_id" << BSON("$in" << idsBab.arr())).
+                           sort("_id", newestFirst ? -1 : 1), 0, 0);
+    }
+    catch (const DBError&)
+    {
+      results.clear();
+      return true;
+    }
+
+    if (limit <= 0 || results.size() >= static_cast<size_t>(limit))
+    {
+      if (limit > 0) results.resize(limit);
+      return true;
+    }
+
+    if (ids.size() < static_cast<size_t>(fetch)) return true;
+
+    fetch *= 2;
+    ids.clear();
+  }
+
+  return false;
+}
+
+bool TrigramIndex::Replicate(const mongo::BSONElement& id)
+{
+  return ReplicateBatch({ id });
+}
+
+bool TrigramIndex::ReplicateBatch(const std::vector<mongo::BSONElement>& ids)
+{
+  mongo::BSONArrayBuilder addedBab;
+  mongo::BSONArrayBuilder removedBab;
+  std::vector<std::string> removed;
+  for (const auto& id : ids)
+  {
+    if (id.type() == mongo::jstOID) addedBab.append(id.OID());
+    else if (id.type() == mongo::String)
+    {
+      removedBab.append(id.String());
+      removed.emplace_back(id.String());
+    }
+  }
+
+  try
+  {
+    SafeConnection conn;
+    auto fields = BSON("_id" << 1 << field << 1);
+    std::vector<mongo::BSONObj> added;
+    if (removed.size() < ids.size())
+    {
+      added = conn.Query(Collection(), QUERY("_id" << BSON("$in" << addedBab.arr())), 
+                         0, 0, &fields);
+    }
+
+    // names removed on another node but added back since are left alone
+    if (!removed.empty())
+    {
+      auto remaining = conn.Query(Collection(), QUERY(field << BSON("$in" << removedBab.arr())), 
+                                  0, 0, &fields);
+      for (const auto& obj : remaining)
+      {
+        auto it = std::find(removed.begin(), removed.end(), obj[field].String());
+        if (it != removed.end()) removed.erase(it);
+      }
+    }
+
+    for (const auto& name : removed)
+    {
+      Remove(name);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& obj : added)
+    {
+      if (obj[field].type() != mongo::String) continue;
+      if (ready) Insert(obj["_id"].OID(), obj[field].String(), true);
+      else Pend(obj["_id"].OID(), obj[field].String());
+    }
+
+    return true;
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Replicate " + Collection() + " search index", e);
+  }
+  catch (const DBError&)
+  {
+  }
+
+  return false;
+}
+
+bool TrigramIndex::Populate()
+{
+  // the replicator has resumed and changes made by other nodes since it
+  // stopped won't be replicated, reload unless not loaded yet
+  std::lock_guard<std::mutex> lock(mutex);
+  if (ready)
+  {
+    loadRequested = true;
+    loadCondition.notify_one();
+  }
+  return true;
+}
+
+} /* db namespace */
@@ -0,0 +1,100 @@
+#ifndef __DB_TRIGRAMINDEX_HPP
+#define __DB_TRIGRAMINDEX_HPP
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+#include <mongo/client/dbclient.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include "db/replicable.hpp"
+
+namespace db
+{
+
+// In memory trigram index over one uniquely indexed string field of a
+// collection, used to shortlist documents for the case insensitive
+// substring searches that the database can only answer by scanning the
+// whole collection. Entries are kept in _id order so matches can be taken
+// newest or oldest first. Changes made by other nodes arrive through the
+// updatelog, logged by id for additions and by name for removals. Removed
+// entries are left in place until they pass a quarter of the live ones,
+// then the index is compacted. The index is reloaded when the replicator
+// resumes after losing its tail, searches aren't answered by it while
+// loading.
+
+class TrigramIndex : public Replicable
+{
+  struct Entry
+  {
+    mongo::OID id;
+    size_t offset;
+    size_t length;
+    bool removed;
+
+    Entry(const mongo::OID& id, size_t offset, size_t length) :
+      id(id), offset(offset), length(length), removed(false) { }
+  };
+
+  std::string field;
+
+  mutable std::mutex mutex;
+  std::string names;
+  std::vector<Entry> entries;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+  size_t tombstones;
+  std::vector<std::pair<mongo::OID, std::string>> pending;
+  bool pendingDropped;
+  bool loadRequested;
+  boost::condition_variable_any loadCondition;
+  std::atomic<bool> ready;
+  boost::thread thread;
+
+  static const int loadBatch = 100000;
+  static const size_t maximumPending = 100000;
+  static const int minimumRetryInterval = 5; // seconds
+  static const int maximumRetryInterval = 300; // seconds
+
+  std::vector<uint32_t> Named(const std::string& name) const;
+  void Insert(const mongo::OID& id, const std::string& name, bool replace);
+  void Tombstone(uint32_t index);
+  void Compact();
+  void Pend(const mongo::OID& id, const std::string& name);
+  bool Matches(const Entry& entry, const std::vector<std::string>& terms) const;
+  bool Find(const std::vector<std::string>& terms, int limit, bool newestFirst,
+            std::vector<mongo::OID>& ids) const;
+  bool Load();
+  void Run();
+
+public:
+  TrigramIndex(const std::string& collection, const std::string& field) :
+    Replicable(collection, false), field(field), tombstones(0), pendingDropped(false),
+    loadRequested(false), ready(false) { }
+
+  // loads the existing documents in the background, retrying while the
+  // database is unavailable
+  void Start();
+  void Stop();
+
+  // a document inserted or about to be inserted with this id, ignored if
+  // the name is already indexed as the insert will be rejected
+  void Add(const mongo::OID& id, const std::string& name);
+  void Remove(const std::string& name);
+
+  // documents whose field contains every term ignoring case, up to limit
+  // if it's above zero. Returns false when the index can't answer because
+  // it isn't loaded or no term is three or more characters long.
+  bool Search(const std::vector<std::string>& terms, int limit, bool newestFirst,
+              std::vector<mongo::BSONObj>& results) const;
+
+  bool Replicate(const mongo::BSONElement& id);
+  bool ReplicateBatch(const std::vector<mongo::BSONElement>& ids);
+  bool Populate();
+};
+
+} /* db namespace */
+
+#endif
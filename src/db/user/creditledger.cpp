@@ -0,0 +1,245 @@
+#include <vector>
+#include <unordered_set>
+#include "db/user/creditledger.hpp"
+#include "db/connection.hpp"
+#include "db/serialization.hpp"
+#include "db/replicator.hpp"
+#include "logs/logs.hpp"
+#include "util/verify.hpp"
+#include "util/misc.hpp"
+
+namespace db
+{
+
+namespace
+{
+
+bool ApplyDelta(Connection& conn, acl::UserID uid, const std::string& section, long long kBytes)
+{
+  auto updateExisting = [&]() -> bool
+    {
+      auto query = QUERY("uid" << uid <<
+                         "credits" << BSON("$elemMatch" << BSON("section" << section)));
+      auto update = BSON("$inc" << BSON("credits.$.value" << kBytes));
+      return conn.Update("users", query, update, false) > 0;
+    };
+
+  auto doInsert = [&]() -> bool
+    {
+      auto query = QUERY("uid" << uid << "credits" << BSON("$not" <<
+                         BSON("$elemMatch" << BSON("section" << section))));
+      auto update = BSON("$push" << BSON("credits" << BSON("section" << section << "value" << kBytes)));
+      return conn.Update("users", query, update, false) > 0;
+    };
+
+  return updateExisting() || doInsert() || updateExisting();
+}
+
+}
+
+std::shared_ptr<CreditLedger> CreditLedger::instance;
+
+bool CreditLedger::Load(acl::UserID uid)
+{
+  std::lock_guard<std::mutex> flushLock(flushMutex);
+
+  std::unordered_map<std::string, long long> credits;
+  try
+  {
+    NoErrorConnection conn;
+    auto fields = BSON("credits" << 1);
+    auto results = conn.Query("users", QUERY("uid" << uid), 1, 0, &fields);
+    if (results.empty()) return false;
+    UnserializeMap(results.front()["credits"].Array(), "section", "value", credits);
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Load credits", e, uid);
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& account = accounts[uid];
+  for (auto& kv : account.sections)
+  {
+    kv.second.value = 0;
+    kv.second.exists = kv.second.pending != 0;
+  }
+
+  for (const auto& kv : credits)
+  {
+    auto& balance = account.sections[kv.first];
+    balance.value = kv.second;
+    balance.exists = true;
+  }
+
+  account.loaded = true;
+  return true;
+}
+
+void CreditLedger::Incr(acl::UserID uid, const std::string& section, long long kBytes)
+{
+  if (!kBytes) return;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& balance = accounts[uid].sections[section];
+  balance.pending += kBytes;
+  balance.exists = true;
+}
+
+bool CreditLedger::Decr(acl::UserID uid, const std::string& section, long long kBytes, bool force)
+{
+  if (!kBytes) return true;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!accounts[uid].loaded)
+    {
+      lock.unlock();
+      if (!Load(uid)) return force;
+    }
+  }
+
+  // check and debit under a single lock so concurrent
+  // downloads by the same user can't overdraw the balance
+  std::lock_guard<std::mutex> lock(mutex);
+  auto& account = accounts[uid];
+  auto it = account.sections.find(section);
+  if (it == account.sections.end() || !it->second.exists) return force;
+
+  Balance& balance = it->second;
+  if (!force && balance.value + balance.pending < kBytes) return false;
+  balance.pending -= kBytes;
+  return true;
+}
+
+long long CreditLedger::Credits(acl::UserID uid, const std::string& section, long long stored)
+{
+  {
+    // the stored value comes from the user cache which isn't
+    // refreshed on credit changes, prefer a loaded balance
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!accounts[uid].loaded)
+    {
+      lock.unlock();
+      Load(uid);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it1 = accounts.find(uid);
+  if (it1 == accounts.end()) return stored;
+
+  auto it2 = it1->second.sections.find(section);
+  if (it2 == it1->second.sections.end())
+    return it1->second.loaded ? 0 : stored;
+
+  const Balance& balance = it2->second;
+  return (it1->second.loaded ? balance.value : stored) + balance.pending;
+}
+
+void CreditLedger::Flush()
+{
+  std::lock_guard<std::mutex> flushLock(flushMutex);
+
+  // deltas stay pending until they're written, a failed write is
+  // retried on the next flush
+  std::vector<Delta> deltas;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& account : accounts)
+    {
+      for (auto& kv : account.second.sections)
+      {
+        const Balance& balance = kv.second;
+        if (balance.pending) deltas.emplace_back(account.first, kv.first, balance.pending);
+      }
+    }
+  }
+
+  if (deltas.empty()) return;
+
+  NoErrorConnection conn;
+  std::unordered_set<acl::UserID> updated;
+  for (const auto& delta : deltas)
+  {
+    bool applied = ApplyDelta(conn, delta.uid, delta.section, delta.kBytes);
+    if (!applied)
+    {
+      logs::Database("Unable to update credits for UID %1%%2%", delta.uid,
+                     !delta.section.empty() ? " in section " + delta.section :
+                     std::string(""));
+
+      // only a deleted user's credits are given up on
+      if (conn.Count("users", BSON("uid" << delta.uid)) != 0) continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Balance& balance = accounts[delta.uid].sections[delta.section];
+    if (applied) balance.value += delta.kBytes;
+    balance.pending -= delta.kBytes;
+    if (applied) updated.insert(delta.uid);
+  }
+
+  for (acl::UserID uid : updated)
+  {
+    LogUpdate("credits", uid);
+  }
+}
+
+bool CreditLedger::Replicate(const mongo::BSONElement& id)
+{
+  if (id.type() != 16) return true;
+  acl::UserID uid = id.Int();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = accounts.find(uid);
+  if (it != accounts.end()) it->second.loaded = false;
+  return true;
+}
+
+bool CreditLedger::Populate()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& kv : accounts)
+  {
+    kv.second.loaded = false;
+  }
+  return true;
+}
+
+void CreditLedger::Run()
+{
+  util::SetProcessTitle("CREDIT LEDGER");
+  try
+  {
+    while (true)
+    {
+      boost::this_thread::sleep(boost::posix_time::milliseconds(flushInterval));
+      Flush();
+    }
+  }
+  catch (const boost::thread_interrupted&)
+  {
+  }
+
+  Flush();
+}
+
+void CreditLedger::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting credit ledger thread..");
+  thread = boost::thread(&CreditLedger::Run, this);
+}
+
+void CreditLedger::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping credit ledger thread..");
+    thread.interrupt();
+    thread.join();
+  }
+}
+
+} /* db namespace */
@@ -0,0 +1,101 @@
+#ifndef __DB_USER_CREDITLEDGER_HPP
+#define __DB_USER_CREDITLEDGER_HPP
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <boost/thread/thread.hpp>
+#include "acl/types.hpp"
+#include "db/replicable.hpp"
+
+namespace mongo
+{
+class BSONElement;
+}
+
+namespace db
+{
+
+// In memory authoritative credit balances, changes are coalesced and
+// written to the database in batches by a single background writer.
+// Other nodes are notified of flushed changes through the updatelog
+// under the pseudo collection 'credits'. Debits are only checked against
+// this node's view of the balance, so with several nodes a user can
+// overdraw by what other nodes debited within one flush interval plus
+// the replication lag.
+
+class CreditLedger : public Replicable
+{
+  struct Balance
+  {
+    long long value;    // last known database value
+    long long pending;  // unflushed delta, already included in balance
+    bool exists;
+
+    Balance() : value(0), pending(0), exists(false) { }
+  };
+
+  struct Account
+  {
+    bool loaded;
+    std::unordered_map<std::string, Balance> sections;
+
+    Account() : loaded(false) { }
+  };
+
+  struct Delta
+  {
+    acl::UserID uid;
+    std::string section;
+    long long kBytes;
+
+    Delta(acl::UserID uid, const std::string& section, long long kBytes) :
+      uid(uid), section(section), kBytes(kBytes) { }
+  };
+
+  std::mutex mutex;
+  std::unordered_map<acl::UserID, Account> accounts;
+
+  // held while loading balances or flushing so a load never
+  // observes a delta in the database that is still counted as pending
+  std::mutex flushMutex;
+
+  boost::thread thread;
+
+  static std::shared_ptr<CreditLedger> instance;
+  static const int flushInterval = 1000; // milliseconds
+
+  CreditLedger() : Replicable("credits", false) { }
+
+  bool Load(acl::UserID uid);
+  void Flush();
+  void Run();
+
+public:
+  void Start();
+  void Stop();
+
+  void Incr(acl::UserID uid, const std::string& section, long long kBytes);
+  bool Decr(acl::UserID uid, const std::string& section, long long kBytes, bool force);
+  long long Credits(acl::UserID uid, const std::string& section, long long stored);
+
+  bool Replicate(const mongo::BSONElement& id);
+  bool Populate();
+
+  static CreditLedger& Get()
+  {
+    if (!instance) instance.reset(new CreditLedger());
+    return *instance;
+  }
+
+  static std::shared_ptr<CreditLedger> Pointer()
+  {
+    Get();
+    return instance;
+  }
+};
+
+} /* db namespace */
+
+#endif
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include "db/user/ipmaskindex.hpp"
+#include "util/string.hpp"
+
+namespace db
+{
+
+namespace
+{
+
+const char* wildcards = "*?[\\";
+
+}
+
+size_t IPMaskIndex::Find(const std::string& prefix) const
+{
+  size_t node = 0;
+  for (char ch : prefix)
+  {
+    auto it = nodes[node].children.find(ch);
+    if (it == nodes[node].children.end()) return 0;
+    node = it->second;
+  }
+  return node;
+}
+
+void IPMaskIndex::Insert(acl::UserID uid, const std::string& mask)
+{
+  if (mask.find_first_of(wildcards) == std::string::npos)
+  {
+    literals.insert(util::ToLowerCopy(mask));
+    return;
+  }
+
+  // the mask's @ is only guaranteed to line up with the address
+  // separator when it's the sole @ and isn't part of a bracket
+  // expression or escape sequence
+  std::string::size_type at = mask.find('@');
+  if (at == std::string::npos || mask.find('@', at + 1) != std::string::npos ||
+      mask.find_first_of("[\\") < at)
+  {
+    unindexed.emplace_back(uid, mask, Kind::Pattern);
+    return;
+  }
+
+  std::string ident(mask, 0, at);
+  std::string address(mask, at + 1);
+  std::string prefix(address, 0, address.find_first_of(wildcards));
+  std::string rest(address, prefix.size());
+
+  Kind kind = Kind::Pattern;
+  if (ident == "*")
+  {
+    if (rest.empty()) kind = Kind::Exact;
+    else if (rest.find_first_not_of('*') == std::string::npos) kind = Kind::Any;
+  }
+
+  util::ToLower(prefix);
+  size_t node = 0;
+  for (char ch : prefix)
+  {
+    auto it = nodes[node].children.find(ch);
+    if (it == nodes[node].children.end())
+    {
+      nodes.emplace_back();
+      it = nodes[node].children.insert(std::make_pair(ch, nodes.size() - 1)).first;
+    }
+    node = it->second;
+  }
+
+  nodes[node].entries.emplace_back(uid, mask, kind);
+}
+
+void IPMaskIndex::Erase(acl::UserID uid, const std::string& mask)
+{
+  auto matches = [&](const Entry& entry) { return entry.uid == uid && entry.mask == mask; };
+
+  if (mask.find_first_of(wildcards) == std::string::npos)
+  {
+    auto it = literals.find(util::ToLowerCopy(mask));
+    if (it != literals.end()) literals.erase(it);
+    return;
+  }
+
+  std::string::size_type at = mask.find('@');
+  std::vector<Entry>* entries = &unindexed;
+  if (at != std::string::npos && mask.find('@', at + 1) == std::string::npos &&
+      mask.find_first_of("[\\") >= at)
+  {
+    std::string prefix(mask, at + 1);
+    prefix.erase(std::min(prefix.find_first_of(wildcards), prefix.size()));
+    util::ToLower(prefix);
+    size_t node = Find(prefix);
+    if (node == 0 && !prefix.empty()) return;
+    entries = &nodes[node].entries;
+  }
+
+  auto it = std::find_if(entries->begin(), entries->end(), matches);
+  if (it != entries->end()) entries->erase(it);
+}
+
+void IPMaskIndex::Add(acl::UserID uid, const std::vector<std::string>& userMasks)
+{
+  Remove(uid);
+  for (const auto& mask : userMasks)
+  {
+    Insert(uid, mask);
+  }
+  masks[uid] = userMasks;
+}
+
+void IPMaskIndex::Remove(acl::UserID uid)
+{
+  auto it = masks.find(uid);
+  if (it == masks.end()) return;
+
+  for (const auto& mask : it->second)
+  {
+    Erase(uid, mask);
+  }
+  masks.erase(it);
+}
+
+bool IPMaskIndex::MatchLinear(const std::string& identAddress) const
+{
+  return std::find_if(masks.begin(), masks.end(),
+              [&](const std::pair<acl::UserID, std::vector<std::string>>& kv)
+              {
+                return util::WildcardMatch(kv.second, identAddress, true);
+              }) != masks.end();
+}
+
+bool IPMaskIndex::Match(const std::string& identAddress) const
+{
+  std::string lower(util::ToLowerCopy(identAddress));
+  if (literals.find(lower) != literals.end()) return true;
+
+  // an ident containing @ could be matched by a mask's ident part
+  // spilling into the address, these are rare enough to test in full
+  std::string::size_type at = identAddress.find('@');
+  if (at == std::string::npos || identAddress.find('@', at + 1) != std::string::npos)
+    return MatchLinear(identAddress);
+
+  lower.erase(0, at + 1);
+  size_t node = 0;
+  for (size_t depth = 0; ; ++depth)
+  {
+    for (const auto& entry : nodes[node].entries)
+    {
+      switch (entry.kind)
+      {
+        case Kind::Any      :
+          return true;
+        case Kind::Exact    :
+          if (depth == lower.size()) return true;
+          break;
+        case Kind::Pattern  :
+          if (util::WildcardMatch(entry.mask, identAddress, true)) return true;
+          break;
+      }
+    }
+
+    if (depth == lower.size()) break;
+    auto it = nodes[node].children.find(lower[depth]);
+    if (it == nodes[node].children.end()) break;
+    node = it->second;
+  }
+
+  return std::find_if(unindexed.begin(), unindexed.end(), [&](const Entry& entry)
+            {
+              return util::WildcardMatch(entry.mask, identAddress, true);
+            }) != unindexed.end();
+}
+
+} /* db namespace */
@@ -0,0 +1,66 @@
+#ifndef __DB_USER_IPMASKINDEX_HPP
+#define __DB_USER_IPMASKINDEX_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include "acl/types.hpp"
+
+namespace db
+{
+
+// Index of user ip masks for connection admission. Masks of the form
+// ident@address are stored in a prefix tree keyed on the literal part
+// of the address that precedes the first wildcard, so only masks that
+// can possibly match an address are tested. Results are identical to
+// testing every mask with util::WildcardMatch.
+
+class IPMaskIndex
+{
+  enum class Kind : int
+  {
+    Any,      // *@prefix* matches anything under the node
+    Exact,    // *@literal matches only at the end of the address
+    Pattern   // anything else is tested with fnmatch
+  };
+
+  struct Entry
+  {
+    acl::UserID uid;
+    std::string mask;
+    Kind kind;
+
+    Entry(acl::UserID uid, const std::string& mask, Kind kind) :
+      uid(uid), mask(mask), kind(kind) { }
+  };
+
+  struct Node
+  {
+    std::map<char, size_t> children;
+    std::vector<Entry> entries;
+  };
+
+  std::vector<Node> nodes;
+  std::vector<Entry> unindexed;
+  std::unordered_multiset<std::string> literals;
+  std::unordered_map<acl::UserID, std::vector<std::string>> masks;
+
+  void Insert(acl::UserID uid, const std::string& mask);
+  void Erase(acl::UserID uid, const std::string& mask);
+  size_t Find(const std::string& prefix) const;
+  bool MatchLinear(const std::string& identAddress) const;
+
+public:
+  IPMaskIndex() : nodes(1) { }
+
+  void Add(acl::UserID uid, const std::vector<std::string>& userMasks);
+  void Remove(acl::UserID uid);
+
+  bool Match(const std::string& identAddress) const;
+};
+
+} /* db namespace */
+
+#endif
@@ -1,4 +1,3 @@
-#include <future>
 #include "db/user/user.hpp"
 #include "db/connection.hpp"
 #include "acl/user.hpp"
@@ -6,41 +5,60 @@
 #include "db/error.hpp"
 #include "db/user/util.hpp"
 #include "db/group/util.hpp"
-#include "util/futureminder.hpp"
+#include "db/user/creditledger.hpp"
+#include "db/writequeue.hpp"
+#include "db/replicator.hpp"
 #include "acl/userdata.hpp"
 
 namespace db
 {
 
+template <> mongo::BSONObj Serialize<acl::UserData>(const acl::UserData& user);
+
 bool User::Create()
 {
+  // matches the object id date the user is loaded back with
+  user.created = boost::gregorian::day_clock::local_day();
+  
   NoErrorConnection conn;
   user.id = conn.InsertAutoIncrement("users", user, "uid");
   if (user.id == -1) return false;
+  CacheUser(user);
   UpdateLog();
   return true;
 }
 
 void User::UpdateLog() const
 {
-  FastConnection conn;
-  auto entry = BSON("collection" << "users" << "id" << user.id);
-  conn.Insert("updatelog", entry);
+  LogUpdate("users", user.id);
 }
 
-void User::SaveField(const std::string& field, bool updateLog) const
+void User::SaveFields(const std::vector<std::string>& fields, bool updateLog) const
 {
-  NoErrorConnection conn;
-  conn.SetField("users", QUERY("uid" << user.id), user, field);
+  auto obj = Serialize(user);
+  mongo::BSONObjBuilder bob;
+  for (const std::string& field : fields)
+  {
+    bob.append(obj[field]);
+  }
+  
+  WriteQueue::Get().Update("users", QUERY("uid" << user.id), BSON("$set" << bob.obj()));
+  CacheUser(user);
   if (updateLog) UpdateLog();
 }
 
+void User::SaveField(const std::string& field, bool updateLog) const
+{
+  SaveFields({ field }, updateLog);
+}
+
 bool User::SaveName()
 {
   try
   {
     SafeConnection conn;
     conn.SetField("users", QUERY("uid" << user.id), user, "name" );
+    CacheUser(user);
     UpdateLog();
     return true;
   }
@@ -57,9 +75,7 @@ void User::SaveIPMasks()
 
 void User::SavePassword()
 {
-  NoErrorConnection conn;
-  conn.SetFields("users", QUERY("uid" << user.id), user, { "password", "salt" });
-  UpdateLog();
+  SaveFields({ "password", "salt" });
 }
 
 void User::SaveFlags()
@@ -69,9 +85,7 @@ void User::SaveFlags()
 
 void User::SaveGIDs()
 {
-  NoErrorConnection conn;
-  conn.SetFields("users", QUERY("uid" << user.id), user, { "primary gid", "secondary gids", "gadmin gids" });
-  UpdateLog();
+  SaveFields({ "primary gid", "secondary gids", "gadmin gids" });
 }
 
 void User::SaveGadminGIDs()
@@ -136,8 +150,7 @@ void User::SaveMaxSimUp()
 
 void User::SaveLoggedIn()
 {
-  NoErrorConnection conn;
-  conn.SetFields("users", QUERY("uid" << user.id), user, { "logged in", "last login" });
+  SaveFields({ "logged in", "last login" }, false);
 }
 
 void User::SaveRatio()
@@ -145,78 +158,28 @@ void User::SaveRatio()
   SaveField("ratio");
 }
 
-namespace
+void User::IncrCredits(const std::string& section, long long kBytes)
 {
-util::FutureMinder asyncTasks;
+  CreditLedger::Get().Incr(user.id, section, kBytes);
 }
 
-void User::IncrCredits(const std::string& section, long long kBytes)
+bool User::DecrCredits(const std::string& section, long long kBytes, bool force)
 {
-  auto doIncrement = [section, kBytes](acl::UserID uid)
-    {
-      NoErrorConnection conn;
-      auto updateExisting = [&]() -> bool
-        {
-          auto query = BSON("uid" << uid << 
-                            "credits" << BSON("$elemMatch" << BSON("section" << section)));
-                            
-          auto update = BSON("$inc" << BSON("credits.$.value" << kBytes));
-                            
-          auto cmd = BSON("findandmodify" << "users" <<
-                          "query" << query <<
-                          "update" << update);
-                          
-          mongo::BSONObj result;
-          return conn.RunCommand(cmd, result) && 
-                 result["value"].type() != mongo::jstNULL;
-        };
-
-      auto doInsert = [&]() -> bool
-      {
-        auto query = QUERY("uid" << uid << "credits" << BSON("$not" << 
-                           BSON("$elemMatch" << BSON("section" << section))));
-        auto update = BSON("$push" << BSON("credits" << BSON("section" << section << "value" << kBytes)));
-        return conn.Update("users", query, update, false) > 0;
-      };
-      
-      if (updateExisting()) return;
-      if (doInsert()) return;
-      if (updateExisting()) return;
-
-      logs::Database("Unable to increment credits for UID %1%%2%", uid,
-                     !section.empty() ? " in section " + section : 
-                     std::string(""));
-    };
-  
-  asyncTasks.Assign(std::async(std::launch::async, doIncrement, user.id));
+  return CreditLedger::Get().Decr(user.id, section, kBytes, force);
 }
 
-bool User::DecrCredits(const std::string& section, long long kBytes, bool force)
+long long User::Credits(const std::string& section) const
 {
-  if (!kBytes) return true;
-  
-  mongo::BSONObjBuilder elemQuery;
-  elemQuery.append("section", section);
-  if (!force) elemQuery.append("value", BSON("$gte" << kBytes));
-  
-  auto query = BSON("uid" << user.id << 
-                    "credits" << BSON("$elemMatch" << elemQuery.obj()));
-                    
-  auto update = BSON("$inc" << BSON("credits.$.value" << -kBytes));
-                    
-  auto cmd = BSON("findandmodify" << "users" <<
-                  "query" << query <<
-                  "update" << update);
-  NoErrorConnection conn;                  
-  mongo::BSONObj result;
-  bool ret = conn.RunCommand(cmd, result);
-  return force || (ret && result["value"].type() != mongo::jstNULL);
+  auto it = user.credits.find(section);
+  return CreditLedger::Get().Credits(user.id, section, 
+                                     it != user.credits.end() ? it->second : 0);
 }
 
 void User::Purge() const
 {
   NoErrorConnection conn;
   conn.Remove("users", QUERY("uid" << user.id));
+  UncacheUser(user.id);
   UpdateLog();
 }
 
@@ -314,13 +277,23 @@ template <> acl::UserData Unserialize<acl::UserData>(const mongo::BSONObj& obj)
   }
 }
 
-boost::optional<acl::UserData> User::Load(acl::UserID uid)
+std::shared_ptr<const acl::UserData> User::Load(acl::UserID uid)
+{
+  return LookupUser(uid);
+}
+
+std::shared_ptr<const acl::UserData> User::Load(const std::string& name)
+{
+  return LookupUser(name);
+}
+
+boost::optional<acl::UserData> User::Fetch(acl::UserID uid)
 {
   NoErrorConnection conn;                  
   return conn.QueryOne<acl::UserData>("users", QUERY("uid" << uid));
 }
 
-boost::optional<acl::UserData> User::Load(const std::string& name)
+boost::optional<acl::UserData> User::Fetch(const std::string& name)
 {
   NoErrorConnection conn;                  
   return conn.QueryOne<acl::UserData>("users", QUERY("name" << name));
@@ -371,12 +344,22 @@ std::vector<T> GetUsersGeneric(const std::string& multiStr, const mongo::BSONObj
 }
 
 std::vector<acl::UserID> GetUIDs(const std::string& multiStr)
+{
+  return LookupUIDs(multiStr);
+}
+
+std::vector<acl::UserData> GetUsers(const std::string& multiStr)
+{
+  return LookupUsers(multiStr);
+}
+
+std::vector<acl::UserID> FetchUIDs(const std::string& multiStr)
 {
   auto fields = BSON("uid" << 1);
   return GetUsersGeneric<acl::UserID>(multiStr, &fields);
 }
 
-std::vector<acl::UserData> GetUsers(const std::string& multiStr)
+std::vector<acl::UserData> FetchUsers(const std::string& multiStr)
 {
   return GetUsersGeneric<acl::UserData>(multiStr, nullptr);
 }
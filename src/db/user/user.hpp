@@ -28,6 +28,7 @@ class User
   acl::UserData& user;
 
   void UpdateLog() const;
+  void SaveFields(const std::vector<std::string>& fields, bool updateLog = true) const;
   void SaveField(const std::string& field, bool updateLog = true) const;
   
 public:
@@ -55,16 +56,24 @@ public:
   void SaveRatio();
   void IncrCredits(const std::string& section, long long kBytes);
   bool DecrCredits(const std::string& section, long long kBytes, bool force);
+  long long Credits(const std::string& section) const;
   
   void Purge() const;
   
-  static boost::optional<acl::UserData> Load(acl::UserID uid);
-  static boost::optional<acl::UserData> Load(const std::string& name);
+  static std::shared_ptr<const acl::UserData> Load(acl::UserID uid);
+  static std::shared_ptr<const acl::UserData> Load(const std::string& name);
+  
+  // bypass the user cache and query the database directly
+  static boost::optional<acl::UserData> Fetch(acl::UserID uid);
+  static boost::optional<acl::UserData> Fetch(const std::string& name);
 };
 
 std::vector<acl::UserID> GetUIDs(const std::string& multiStr = "*");
 std::vector<acl::UserData> GetUsers(const std::string& multiStr = "*");
 
+std::vector<acl::UserID> FetchUIDs(const std::string& multiStr = "*");
+std::vector<acl::UserData> FetchUsers(const std::string& multiStr = "*");
+
 } /* db namespace */
 
 #endif
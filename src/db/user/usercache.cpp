@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <unordered_set>
 #include "db/user/usercache.hpp"
 #include "db/connection.hpp"
 #include "util/string.hpp"
@@ -5,13 +7,117 @@
 #include "acl/userdata.hpp"
 #include "db/user/serialization.hpp"
 #include "db/user/util.hpp"
+#include "db/group/util.hpp"
+#include "db/serialization.hpp"
+#include "logs/logs.hpp"
 
 namespace db
 {
 
+template <> mongo::BSONObj Serialize<acl::UserData>(const acl::UserData& user);
+template <> acl::UserData Unserialize<acl::UserData>(const mongo::BSONObj& obj);
+
+void UserCache::Indexes::Erase(acl::UserID uid)
+{
+  auto it = names.find(uid);
+  if (it != names.end())
+  {
+    uids.erase(it->second);
+    names.erase(it);
+  }
+  primaryGids.erase(uid);
+  ipMasks.erase(uid);
+  ipIndex.Remove(uid);
+}
+
+void UserCache::Indexes::Insert(const acl::UserData& user)
+{
+  // name may have changed, remove the old entry first
+  Erase(user.id);
+  uids[user.name] = user.id;
+  names[user.id] = user.name;
+  primaryGids[user.id] = user.primaryGid;
+  ipMasks[user.id] = user.ipMasks;
+  ipIndex.Add(user.id, user.ipMasks);
+}
+
+UserCache::Snapshot::Snapshot() :
+  indexes(std::make_shared<Indexes>())
+{
+  auto empty = std::make_shared<Shard>();
+  shards.fill(empty);
+}
+
+std::shared_ptr<const acl::UserData> UserCache::Snapshot::Find(acl::UserID uid) const
+{
+  const Shard& shard = *shards[uid % shardCount];
+  auto it = shard.find(uid);
+  if (it == shard.end()) return nullptr;
+  return it->second;
+}
+
+UserCache::Builder::Builder(const Snapshot& current) :
+  next(std::make_shared<Snapshot>(current))
+{
+}
+
+UserCache::Indexes& UserCache::Builder::MutableIndexes()
+{
+  // copied on first change, later changes in the same build reuse it
+  if (!indexes)
+  {
+    indexes = std::make_shared<Indexes>(*next->indexes);
+    next->indexes = indexes;
+  }
+  return *indexes;
+}
+
+UserCache::Shard& UserCache::Builder::MutableShard(acl::UserID uid)
+{
+  size_t index = uid % shardCount;
+  if (!shards[index])
+  {
+    shards[index] = std::make_shared<Shard>(*next->shards[index]);
+    next->shards[index] = shards[index];
+  }
+  return *shards[index];
+}
+
+void UserCache::Builder::Insert(acl::UserData&& user)
+{
+  Shard& shard = MutableShard(user.id);
+  auto it = shard.find(user.id);
+  if (it == shard.end() || it->second->name != user.name ||
+      it->second->primaryGid != user.primaryGid ||
+      it->second->ipMasks != user.ipMasks)
+  {
+    MutableIndexes().Insert(user);
+  }
+  
+  acl::UserID uid = user.id;
+  shard[uid] = std::make_shared<const acl::UserData>(std::move(user));
+}
+
+void UserCache::Builder::Erase(acl::UserID uid)
+{
+  if (!next->Find(uid)) return;
+  MutableShard(uid).erase(uid);
+  MutableIndexes().Erase(uid);
+}
+
+UserCache::UserCache(const std::function<void(acl::UserID)>& updatedCallback) : 
+  Replicable("users"),
+  snapshot(std::make_shared<Snapshot>()),
+  updatedCallback(updatedCallback),
+  hits(0),
+  misses(0)
+{
+}
+
 std::string UserCache::UIDToName(acl::UserID uid)
 {
-  std::lock_guard<std::mutex> lock(namesMutex);
+  auto current = Current();
+  const auto& names = current->indexes->names;
   auto it = names.find(uid);
   if (it == names.end()) return "unknown";
   return it->second;
@@ -19,7 +125,8 @@ std::string UserCache::UIDToName(acl::UserID uid)
 
 acl::UserID UserCache::NameToUID(const std::string& name)
 {
-  std::lock_guard<std::mutex> lock(uidsMutex);
+  auto current = Current();
+  const auto& uids = current->indexes->uids;
   auto it = uids.find(name);
   if (it == uids.end()) return -1;
   return it->second;
@@ -27,7 +134,8 @@ acl::UserID UserCache::NameToUID(const std::string& name)
 
 acl::GroupID UserCache::UIDToPrimaryGID(acl::UserID uid)
 {
-  std::lock_guard<std::mutex> lock(primaryGidsMutex);
+  auto current = Current();
+  const auto& primaryGids = current->indexes->primaryGids;
   auto it = primaryGids.find(uid);
   if (it == primaryGids.end()) return -1;
   return it ->second;
@@ -35,17 +143,13 @@ acl::GroupID UserCache::UIDToPrimaryGID(acl::UserID uid)
 
 bool UserCache::IdentIPAllowed(const std::string& identAddress)
 {
-  std::lock_guard<std::mutex> lock(ipMasksMutex);
-  return std::find_if(ipMasks.begin(), ipMasks.end(), 
-              [&](const std::pair<acl::UserID, std::vector<std::string>>& kv)
-              {
-                return util::WildcardMatch(kv.second, identAddress, true);
-              }) != ipMasks.end();
+  return Current()->indexes->ipIndex.Match(identAddress);
 }
 
 bool UserCache::IdentIPAllowed(const std::string& identAddress, acl::UserID uid)
 {
-  std::lock_guard<std::mutex> lock(ipMasksMutex);
+  auto current = Current();
+  const auto& ipMasks = current->indexes->ipMasks;
   auto it = ipMasks.find(uid);
   if (it == ipMasks.end()) return false;
   return util::WildcardMatch(it->second, identAddress, true);
@@ -53,100 +157,268 @@ bool UserCache::IdentIPAllowed(const std::string& identAddress, acl::UserID uid)
 
 bool UserCache::Replicate(const mongo::BSONElement& id)
 {
-  if (id.type() != 16) return true;
-  acl::UserID uid = id.Int();
+  return ReplicateBatch({ id });
+}
 
-  updatedCallback(uid);
+bool UserCache::ReplicateBatch(const std::vector<mongo::BSONElement>& ids)
+{
+  mongo::BSONArrayBuilder uidsBab;
+  std::vector<acl::UserID> replicated;
+  for (const auto& id : ids)
+  {
+    if (id.type() != 16) continue;
+    acl::UserID uid = id.Int();
+    uidsBab.append(uid);
+    replicated.emplace_back(uid);
+  }
   
+  if (replicated.empty()) return true;
+
+  std::vector<acl::UserData> users;
   try
   {
     SafeConnection conn;  
-    auto fields = BSON("uid" << 1 << "name" << 1 << "primary gid" << 1);
-    auto data = conn.QueryOne<UserTriple>("users", QUERY("uid" << uid), &fields);
-    if (data)
+    users = conn.QueryMulti<acl::UserData>("users", QUERY("uid" << BSON("$in" << uidsBab.arr())));
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Replicate users", e);
+    return false;
+  }
+  catch (const DBError&)
+  {
+    return false;
+  }
+  
+  {
+    // the whole batch is published as one new snapshot
+    std::lock_guard<std::mutex> lock(writeMutex);
+    Builder builder(*Current());
+
+    // users not found must be deleted, remove from cache
+    std::unordered_set<acl::UserID> found;
+    for (const auto& user : users)
     {
-      // user found, refresh cached data
-      {
-        std::lock_guard<std::mutex> lock(uidsMutex);
-        uids[data->name] = data->uid;
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(namesMutex);
-        names[data->uid] = data->name;
-      }
-      
-      {
-        std::lock_guard<std::mutex> lock(primaryGidsMutex);
-        primaryGids[data->uid] = data->primaryGid;
-      }
-      
-      auto masks = LookupIPMasks(conn, uid);
-      
-      {
-        std::lock_guard<std::mutex> lock(ipMasksMutex);
-        ipMasks[data->uid] = std::move(masks);
-      }
+      found.insert(user.id);
     }
-    else
+    
+    for (acl::UserID uid : replicated)
+    {
+      if (!found.count(uid)) builder.Erase(uid);
+    }
+    
+    for (auto& user : users)
+    {
+      builder.Insert(std::move(user));
+    }
+    
+    Publish(builder.Build());
+  }
+  
+  // callbacks reload from the cache so must follow the publish
+  for (acl::UserID uid : replicated)
+  {
+    updatedCallback(uid);
+  }
+  
+  return true;
+}
+
+bool UserCache::Populate()
+{
+  // held from the fetch so a replicated update can't be overwritten
+  // by the older copy fetched here
+  std::lock_guard<std::mutex> lock(writeMutex);
+  auto users = FetchUsers();
+  
+  Builder builder{Snapshot()};
+  for (auto& user : users)
+  {
+    builder.Insert(std::move(user));
+  }
+  
+  Publish(builder.Build());
+  return true;
+}
+
+std::shared_ptr<const acl::UserData> UserCache::Load(acl::UserID uid)
+{
+  auto user = Current()->Find(uid);
+  if (user)
+  {
+    ++hits;
+    return user;
+  }
+  
+  // may have been created on another node and not yet replicated
+  ++misses;
+  auto fetched = User::Fetch(uid);
+  if (!fetched) return nullptr;
+  return std::make_shared<const acl::UserData>(std::move(*fetched));
+}
+
+std::shared_ptr<const acl::UserData> UserCache::Load(const std::string& name)
+{
+  {
+    auto current = Current();
+    const auto& uids = current->indexes->uids;
+    auto it = uids.find(name);
+    if (it != uids.end())
     {
-      // user not found, must be deleted, remove from cache
+      auto user = current->Find(it->second);
+      if (user)
       {
-        std::lock(uidsMutex, namesMutex);
-        std::lock_guard<std::mutex> uidsLock(uidsMutex, std::adopt_lock);
-        std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
-        
-        auto it = names.find(uid);
-        if (it != names.end())
-        {
-          uids.erase(it->second);
-          names.erase(it);
-        }
+        ++hits;
+        return user;
       }
-      
+    }
+  }
+  
+  ++misses;
+  auto fetched = User::Fetch(name);
+  if (!fetched) return nullptr;
+  return std::make_shared<const acl::UserData>(std::move(*fetched));
+}
+
+template <typename T>
+std::vector<T> UserCache::Select(const std::string& multiStr, 
+                                 const std::function<T(const acl::UserData&)>& get)
+{
+  std::vector<std::string> toks;
+  util::Split(toks, multiStr, " ", true);
+
+  // same matching rules as the database query in FetchUsers
+  bool all = std::find(toks.begin(), toks.end(), "*") != toks.end();
+  std::unordered_set<std::string> names;
+  std::unordered_set<acl::GroupID> gids;
+  if (!all)
+  {
+    for (std::string tok : toks)
+    {
+      if (tok[0] == '=')
       {
-        std::lock_guard<std::mutex> lock(primaryGidsMutex);
-        primaryGids.erase(uid);
+        acl::GroupID gid = NameToGID(tok.substr(1));
+        if (gid != -1) gids.insert(gid);
+        continue;
       }
       
+      if (tok[0] == '-') tok.erase(0, 1);
+      names.insert(tok);
+    }
+  }
+  
+  auto current = Current();
+  std::vector<std::shared_ptr<const acl::UserData>> matches;
+  for (const auto& shard : current->shards)
+  {
+    for (const auto& kv : *shard)
+    {
+      const acl::UserData& user = *kv.second;
+      if (all || names.count(user.name) || gids.count(user.primaryGid) ||
+          std::find_if(user.secondaryGids.begin(), user.secondaryGids.end(),
+                       [&](acl::GroupID gid) { return gids.count(gid) > 0; }) != 
+            user.secondaryGids.end())
       {
-        std::lock_guard<std::mutex> lock(ipMasksMutex);
-        ipMasks.erase(uid);
+        matches.emplace_back(kv.second);
       }
     }
   }
-  catch (const DBError&)
+  
+  std::sort(matches.begin(), matches.end(), 
+            [](const std::shared_ptr<const acl::UserData>& a, 
+               const std::shared_ptr<const acl::UserData>& b) { return a->id < b->id; });
+  
+  ++hits;
+  std::vector<T> results;
+  results.reserve(matches.size());
+  for (const auto& user : matches)
   {
-    return false;
+    results.emplace_back(get(*user));
   }
-  
-  return true;
+  return results;
 }
 
-bool UserCache::Populate()
+std::vector<acl::UserData> UserCache::GetUsers(const std::string& multiStr)
 {
-  auto users = GetUsers();
+  return Select<acl::UserData>(multiStr, [](const acl::UserData& user) { return user; });
+}
+
+std::vector<acl::UserID> UserCache::GetUIDs(const std::string& multiStr)
+{
+  return Select<acl::UserID>(multiStr, [](const acl::UserData& user) { return user.id; });
+}
+
+void UserCache::Store(const acl::UserData& user)
+{
+  std::lock_guard<std::mutex> lock(writeMutex);
+  Builder builder(*Current());
+  builder.Insert(acl::UserData(user));
+  Publish(builder.Build());
+}
+
+void UserCache::Erase(acl::UserID uid)
+{
+  std::lock_guard<std::mutex> lock(writeMutex);
+  auto current = Current();
+  if (!current->Find(uid)) return;
   
-  std::lock(namesMutex, uidsMutex, primaryGidsMutex, ipMasksMutex);
-  std::lock_guard<std::mutex> namesLock(namesMutex, std::adopt_lock);
-  std::lock_guard<std::mutex> uidsLock(uidsMutex, std::adopt_lock);
-  std::lock_guard<std::mutex> primaryGidsLock(primaryGidsMutex, std::adopt_lock);
-  std::lock_guard<std::mutex> ipMasksLock(ipMasksMutex, std::adopt_lock);
+  Builder builder(*current);
+  builder.Erase(uid);
+  Publish(builder.Build());
+}
+
+size_t UserCache::Verify()
+{
+  // credits and logged in counts are maintained outside the cache
+  static const std::unordered_set<std::string> ignored = { "credits", "logged in" };
   
-  uids.clear();
-  names.clear();
-  primaryGids.clear();
-  ipMasks.clear();
+  auto differs = [&](const mongo::BSONObj& a, const mongo::BSONObj& b) -> bool
+    {
+      mongo::BSONObjIterator it(a);
+      while (it.more())
+      {
+        auto elem = it.next();
+        std::string field(elem.fieldName());
+        if (ignored.count(field)) continue;
+        if (elem.woCompare(b[field], false) != 0) return true;
+      }
+      return false;
+    };
   
+  auto users = FetchUsers();
+  auto current = Current();
+  size_t inconsistent = 0;
+  std::unordered_set<acl::UserID> seen;
   for (const auto& user : users)
   {
-    uids[user.name] = user.id;
-    names[user.id] = std::move(user.name);
-    primaryGids[user.id] = user.primaryGid;
-    ipMasks[user.id] = std::move(user.ipMasks);
+    seen.insert(user.id);
+    auto cached = current->Find(user.id);
+    if (!cached)
+    {
+      logs::Database("User cache missing UID %1% (%2%)", user.id, user.name);
+      ++inconsistent;
+    }
+    else
+    if (differs(Serialize(user), Serialize(*cached)))
+    {
+      logs::Database("User cache inconsistent for UID %1% (%2%)", user.id, user.name);
+      ++inconsistent;
+    }
+  }
+  
+  for (const auto& shard : current->shards)
+  {
+    for (const auto& kv : *shard)
+    {
+      if (!seen.count(kv.first))
+      {
+        logs::Database("User cache holds deleted UID %1% (%2%)", kv.first, kv.second->name);
+        ++inconsistent;
+      }
+    }
   }
   
-  return true;
+  return inconsistent;
 }
 
 } /* db namespace */
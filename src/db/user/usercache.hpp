@@ -1,20 +1,30 @@
 #ifndef __DB_USERCACHE_HPP
 #define __DB_USERCACHE_HPP
 
+#include <array>
 #include <string>
 #include <functional>
 #include <unordered_map>
 #include <vector>
+#include <memory>
 #include <mutex>
+#include <atomic>
 #include "acl/types.hpp"
 #include "db/replicable.hpp"
 #include "db/user/usercachebase.hpp"
+#include "db/user/ipmaskindex.hpp"
+#include "util/published.hpp"
 
 namespace mongo
 {
 class BSONElement;
 }
 
+namespace acl
+{
+struct UserData;
+}
+
 namespace db
 {
 
@@ -22,33 +32,89 @@ class UserCache :
   public UserCacheBase,
   public Replicable
 {
-  std::mutex namesMutex;
-  std::unordered_map<acl::UserID, std::string> names;
+  typedef std::unordered_map<acl::UserID, std::shared_ptr<const acl::UserData>> Shard;
+  static const size_t shardCount = 64;
 
-  std::mutex uidsMutex;
-  std::unordered_map<std::string, acl::UserID> uids;
-  
-  std::mutex primaryGidsMutex;
-  std::unordered_map<acl::UserID, acl::GroupID> primaryGids;
+  struct Indexes
+  {
+    std::unordered_map<acl::UserID, std::string> names;
+    std::unordered_map<std::string, acl::UserID> uids;
+    std::unordered_map<acl::UserID, acl::GroupID> primaryGids;
+    std::unordered_map<acl::UserID, std::vector<std::string>> ipMasks;
+    IPMaskIndex ipIndex;
+    
+    void Insert(const acl::UserData& user);
+    void Erase(acl::UserID uid);
+  };
 
-  std::mutex ipMasksMutex;
-  std::unordered_map<acl::UserID, std::vector<std::string>> ipMasks;
+  // immutable once published, readers take a reference to the current
+  // snapshot and writers build a new one and swap it in under writeMutex.
+  // Users are split into shards and a new snapshot shares every shard
+  // and the indexes with the last, a write copies only the shard holding
+  // the user and the indexes when a name, primary group or IP mask changes.
+  struct Snapshot
+  {
+    std::shared_ptr<const Indexes> indexes;
+    std::array<std::shared_ptr<const Shard>, shardCount> shards;
+    
+    Snapshot();
+    std::shared_ptr<const acl::UserData> Find(acl::UserID uid) const;
+  };
+  
+  class Builder
+  {
+    std::shared_ptr<Snapshot> next;
+    std::shared_ptr<Indexes> indexes;
+    std::array<std::shared_ptr<Shard>, shardCount> shards;
+    
+    Indexes& MutableIndexes();
+    Shard& MutableShard(acl::UserID uid);
+    
+  public:
+    explicit Builder(const Snapshot& current);
+    
+    void Insert(acl::UserData&& user);
+    void Erase(acl::UserID uid);
+    std::shared_ptr<const Snapshot> Build() const { return next; }
+  };
+  
+  util::Published<Snapshot> snapshot;
+  std::mutex writeMutex;
   
   std::function<void(acl::UserID)> updatedCallback;
   
+  std::atomic<unsigned long long> hits;
+  std::atomic<unsigned long long> misses;
+  
+  std::shared_ptr<const Snapshot> Current() const { return snapshot.Get(); }
+  void Publish(const std::shared_ptr<const Snapshot>& next) { snapshot.Publish(next); }
+  
+  template <typename T>
+  std::vector<T> Select(const std::string& multiStr, 
+                        const std::function<T(const acl::UserData&)>& get);
+  
 public:  
-  UserCache(const std::function<void(acl::UserID)>& updatedCallback) : 
-    Replicable("users"),
-    updatedCallback(updatedCallback)
-  { }
+  UserCache(const std::function<void(acl::UserID)>& updatedCallback);
   
   std::string UIDToName(acl::UserID uid);
   acl::UserID NameToUID(const std::string& name);
   acl::GroupID UIDToPrimaryGID(acl::UserID uid);  
   bool IdentIPAllowed(const std::string& identAddress);
   bool IdentIPAllowed(const std::string& identAddress, acl::UserID uid);
+  std::shared_ptr<const acl::UserData> Load(acl::UserID uid);
+  std::shared_ptr<const acl::UserData> Load(const std::string& name);
+  std::vector<acl::UserData> GetUsers(const std::string& multiStr);
+  std::vector<acl::UserID> GetUIDs(const std::string& multiStr);
+  
+  void Store(const acl::UserData& user);
+  void Erase(acl::UserID uid);
+  size_t Verify();
+  
+  unsigned long long Hits() const { return hits; }
+  unsigned long long Misses() const { return misses; }
 
   bool Replicate(const mongo::BSONElement& id);
+  bool ReplicateBatch(const std::vector<mongo::BSONElement>& ids);
   bool Populate();  
 };
 
@@ -2,8 +2,16 @@
 #define __DB_USERCACHEBASE_HPP
 
 #include <string>
+#include <memory>
+#include <vector>
+#include <boost/optional.hpp>
 #include "acl/types.hpp"
 
+namespace acl
+{
+struct UserData;
+}
+
 namespace db
 {
 
@@ -15,6 +23,15 @@ struct UserCacheBase
   virtual acl::GroupID UIDToPrimaryGID(acl::UserID uid) = 0;
   virtual bool IdentIPAllowed(const std::string& identAddress) = 0;  
   virtual bool IdentIPAllowed(const std::string& identAddress, acl::UserID uid) = 0;  
+  virtual std::shared_ptr<const acl::UserData> Load(acl::UserID uid) = 0;
+  virtual std::shared_ptr<const acl::UserData> Load(const std::string& name) = 0;
+  virtual std::vector<acl::UserData> GetUsers(const std::string& multiStr) = 0;
+  virtual std::vector<acl::UserID> GetUIDs(const std::string& multiStr) = 0;
+  virtual void Store(const acl::UserData& /* user */) { }
+  virtual void Erase(acl::UserID /* uid */) { }
+  virtual size_t Verify() { return 0; }
+  virtual unsigned long long Hits() const { return 0; }
+  virtual unsigned long long Misses() const { return 0; }
 };
 
 } /* db namespace */
@@ -7,6 +7,8 @@
 #include "db/connection.hpp"
 #include "db/user/usercachebase.hpp"
 #include "db/user/serialization.hpp"
+#include "db/user/user.hpp"
+#include "acl/userdata.hpp"
 
 namespace db
 {
@@ -21,6 +23,10 @@ struct UserNoCache : public UserCacheBase
   acl::GroupID UIDToPrimaryGID(acl::UserID uid);  
   bool IdentIPAllowed(const std::string& identAddress);
   bool IdentIPAllowed(const std::string& identAddress, acl::UserID uid);
+  std::shared_ptr<const acl::UserData> Load(acl::UserID uid);
+  std::shared_ptr<const acl::UserData> Load(const std::string& name);
+  std::vector<acl::UserData> GetUsers(const std::string& multiStr);
+  std::vector<acl::UserID> GetUIDs(const std::string& multiStr);
 };
 
 std::string UserNoCache::UIDToName(acl::UserID uid)
@@ -62,6 +68,30 @@ bool UserNoCache::IdentIPAllowed(const std::string& identAddress, acl::UserID ui
   return util::WildcardMatch(LookupIPMasks(conn, uid), identAddress, true);
 }
 
+std::shared_ptr<const acl::UserData> UserNoCache::Load(acl::UserID uid)
+{
+  auto user = User::Fetch(uid);
+  if (!user) return nullptr;
+  return std::make_shared<const acl::UserData>(std::move(*user));
+}
+
+std::shared_ptr<const acl::UserData> UserNoCache::Load(const std::string& name)
+{
+  auto user = User::Fetch(name);
+  if (!user) return nullptr;
+  return std::make_shared<const acl::UserData>(std::move(*user));
+}
+
+std::vector<acl::UserData> UserNoCache::GetUsers(const std::string& multiStr)
+{
+  return FetchUsers(multiStr);
+}
+
+std::vector<acl::UserID> UserNoCache::GetUIDs(const std::string& multiStr)
+{
+  return FetchUIDs(multiStr);
+}
+
 std::shared_ptr<UserCacheBase> userCache(new UserNoCache());
 }
 
@@ -100,6 +130,60 @@ bool IdentIPAllowed(const std::string& identAddress, acl::UserID uid)
   return userCache->IdentIPAllowed(identAddress, uid);
 }
 
+std::shared_ptr<const acl::UserData> LookupUser(acl::UserID uid)
+{
+  assert(userCache);
+  return userCache->Load(uid);
+}
+
+std::shared_ptr<const acl::UserData> LookupUser(const std::string& name)
+{
+  assert(userCache);
+  return userCache->Load(name);
+}
+
+std::vector<acl::UserData> LookupUsers(const std::string& multiStr)
+{
+  assert(userCache);
+  return userCache->GetUsers(multiStr);
+}
+
+std::vector<acl::UserID> LookupUIDs(const std::string& multiStr)
+{
+  assert(userCache);
+  return userCache->GetUIDs(multiStr);
+}
+
+void CacheUser(const acl::UserData& user)
+{
+  assert(userCache);
+  userCache->Store(user);
+}
+
+void UncacheUser(acl::UserID uid)
+{
+  assert(userCache);
+  userCache->Erase(uid);
+}
+
+size_t VerifyUserCache()
+{
+  assert(userCache);
+  return userCache->Verify();
+}
+
+unsigned long long UserCacheHits()
+{
+  assert(userCache);
+  return userCache->Hits();
+}
+
+unsigned long long UserCacheMisses()
+{
+  assert(userCache);
+  return userCache->Misses();
+}
+
 std::vector<std::string> LookupIPMasks(Connection& conn, acl::UserID uid)
 {
   mongo::Query query;
@@ -4,6 +4,7 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <boost/optional.hpp>
 #include "acl/types.hpp"
 
 namespace acl
@@ -26,6 +27,17 @@ acl::GroupID UIDToPrimaryGID(acl::UserID uid);
 bool IdentIPAllowed(const std::string& identAddress);
 bool IdentIPAllowed(const std::string& identAddress, acl::UserID uid);
 
+std::shared_ptr<const acl::UserData> LookupUser(acl::UserID uid);
+std::shared_ptr<const acl::UserData> LookupUser(const std::string& name);
+std::vector<acl::UserData> LookupUsers(const std::string& multiStr);
+std::vector<acl::UserID> LookupUIDs(const std::string& multiStr);
+
+void CacheUser(const acl::UserData& user);
+void UncacheUser(acl::UserID uid);
+size_t VerifyUserCache();
+unsigned long long UserCacheHits();
+unsigned long long UserCacheMisses();
+
 std::vector<std::string> LookupIPMasks(Connection& conn, acl::UserID uid = -1);
 
 } /* db namespace */
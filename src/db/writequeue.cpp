@@ -0,0 +1,328 @@
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "db/writequeue.hpp"
+#include "db/connection.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+#include "util/path/path.hpp"
+#include "util/verify.hpp"
+#include "util/misc.hpp"
+
+namespace db
+{
+
+std::unique_ptr<WriteQueue> WriteQueue::instance;
+
+void WriteQueue::Insert(const std::string& collection, const mongo::BSONObj& obj)
+{
+  if (obj.hasField("_id"))
+  {
+    Push(Operation(Type::Insert, collection, mongo::BSONObj(), obj.getOwned(), false));
+    return;
+  }
+  
+  mongo::BSONObjBuilder bob;
+  bob.append("_id", mongo::OID::gen());
+  bob.appendElements(obj);
+  Push(Operation(Type::Insert, collection, mongo::BSONObj(), bob.obj(), false));
+}
+
+void WriteQueue::Update(const std::string& collection, const mongo::Query& query,
+      const mongo::BSONObj& obj, bool upsert)
+{
+  verify(!obj.hasField("$inc"));
+  Push(Operation(Type::Update, collection, query.obj.getOwned(), obj.getOwned(), upsert));
+}
+
+void WriteQueue::Remove(const std::string& collection, const mongo::Query& query)
+{
+  Push(Operation(Type::Remove, collection, query.obj.getOwned(), mongo::BSONObj(), false));
+}
+
+void WriteQueue::Push(Operation&& op)
+{
+  if (!thread.joinable())
+  {
+    // writer not running, eg. during startup, write synchronously
+    FastConnection conn;
+    Execute(conn, std::vector<Operation>{ std::move(op) });
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+
+  // the writer thread may log database errors which end up back here,
+  // it must never wait on itself
+  if (boost::this_thread::get_id() != thread.get_id())
+  {
+    while (queueBytes >= maximumBytes)
+    {
+      popped.wait(lock);
+    }
+  }
+
+  queueBytes += op.Size();
+  queue.emplace_back(std::move(op));
+  pushed.notify_one();
+}
+
+std::vector<WriteQueue::Operation> WriteQueue::Take(bool wait)
+{
+  std::vector<Operation> batch;
+  std::unique_lock<std::mutex> lock(mutex);
+  if (wait && queue.empty())
+  {
+    pushed.wait_for(lock, std::chrono::milliseconds(waitInterval));
+  }
+
+  while (!queue.empty() && batch.size() < maximumBatch)
+  {
+    queueBytes -= queue.front().Size();
+    batch.emplace_back(std::move(queue.front()));
+    queue.pop_front();
+  }
+
+  if (!batch.empty()) popped.notify_all();
+  return batch;
+}
+
+size_t WriteQueue::Depth() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return queue.size();
+}
+
+void WriteQueue::Execute(Connection& conn, const std::vector<Operation>& batch)
+{
+  auto it = batch.begin();
+  while (it != batch.end())
+  {
+    if (it->type == Type::Update)
+    {
+      conn.Update(it->collection, mongo::Query(it->query), it->obj, it->upsert);
+      ++it;
+      continue;
+    }
+    
+    if (it->type == Type::Remove)
+    {
+      conn.Remove(it->collection, mongo::Query(it->query));
+      ++it;
+      continue;
+    }
+
+    // group consecutive inserts into the same collection, order
+    // relative to the other writes either side of them is preserved
+    std::vector<mongo::BSONObj> objs;
+    auto first = it;
+    for (; it != batch.end() && it->type == Type::Insert &&
+           it->collection == first->collection; ++it)
+    {
+      objs.emplace_back(it->obj);
+    }
+
+    // the rest of a resent batch is still written when some of it was
+    // already written before
+    if (objs.size() == 1) conn.Insert(first->collection, objs.front());
+    else conn.Insert(first->collection, objs, mongo::InsertOption_ContinueOnError);
+  }
+}
+
+bool WriteQueue::Commit(Connection& conn, const std::vector<Operation>& batch)
+{
+  Execute(conn, batch);
+
+  try
+  {
+    // acts as a sync point so the flush latency is meaningful, an error
+    // on a write the database rejected isn't worth retrying. Duplicate
+    // keys are inserts resent after a failure that were already written.
+    auto err = conn.GetLastError();
+    if (!err.Okay() && err["code"].Number() != 11000)
+      LogLastError("Write queue flush", err, batch.size());
+  }
+  catch (const mongo::DBException& e)
+  {
+    LogException("Write queue flush", e, batch.size());
+    return false;
+  }
+
+  return !conn.Failed();
+}
+
+std::string WriteQueue::JournalPath() const
+{
+  return util::path::Join(cfg::Get().Datapath(), "writequeue.journal");
+}
+
+void WriteQueue::Spill(const std::vector<Operation>& batch)
+{
+  if (batch.empty()) return;
+  
+  std::ofstream out(JournalPath(), std::ios::binary | std::ios::app);
+  if (!out)
+  {
+    logs::Database("Unable to open write queue journal, %1% writes lost", batch.size());
+    return;
+  }
+
+  for (const auto& op : batch)
+  {
+    auto entry = BSON("type" << static_cast<int>(op.type) <<
+                      "collection" << op.collection <<
+                      "query" << op.query <<
+                      "obj" << op.obj <<
+                      "upsert" << op.upsert);
+    out.write(entry.objdata(), entry.objsize());
+  }
+
+  journaled += batch.size();
+}
+
+bool WriteQueue::Replay(Connection& conn)
+{
+  if (!journaled) return true;
+
+  std::string path(JournalPath());
+  std::ifstream in(path, std::ios::binary);
+  if (!in)
+  {
+    journaled = 0;
+    return true;
+  }
+
+  std::string buffer((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  in.close();
+
+  std::vector<Operation> batch;
+  size_t pos = 0;
+  while (buffer.size() - pos >= sizeof(int32_t))
+  {
+    int32_t size;
+    std::memcpy(&size, buffer.data() + pos, sizeof(size));
+    if (size <= 0 || static_cast<size_t>(size) > buffer.size() - pos)
+    {
+      logs::Database("Write queue journal truncated at offset %1%", pos);
+      break;
+    }
+
+    try
+    {
+      mongo::BSONObj entry(mongo::BSONObj(buffer.data() + pos).getOwned());
+      batch.emplace_back(static_cast<Type>(entry["type"].Int()),
+                         entry["collection"].String(),
+                         entry["query"].Obj().getOwned(),
+                         entry["obj"].Obj().getOwned(),
+                         entry["upsert"].Bool());
+    }
+    catch (const mongo::DBException& e)
+    {
+      LogException("Write queue journal unserialize", e, pos);
+    }
+
+    pos += size;
+  }
+
+  logs::Database("Replaying %1% journaled writes", batch.size());
+
+  // the journal is kept until the replay is known to have reached the
+  // database, a replay cut short is repeated in full which is safe as
+  // every queued write is idempotent
+  if (!Commit(conn, batch))
+  {
+    logs::Database("Write queue journal replay failed, will retry");
+    return false;
+  }
+
+  std::remove(path.c_str());
+  journaled = 0;
+  return true;
+}
+
+void WriteQueue::Flush(const std::vector<Operation>& batch)
+{
+  if (batch.empty() && !journaled) return;
+
+  auto start = boost::posix_time::microsec_clock::local_time();
+  if (!lastFailure.is_not_a_date_time() &&
+      start - lastFailure < boost::posix_time::seconds(retryInterval))
+  {
+    Spill(batch);
+    return;
+  }
+
+  FastConnection conn;
+  
+  // anything queued in memory is newer than the journal
+  if (!conn.Connected() || !Replay(conn) || !Commit(conn, batch))
+  {
+    lastFailure = start;
+    Spill(batch);
+    return;
+  }
+  
+  lastFailure = boost::posix_time::not_a_date_time;
+  flushLatency = (boost::posix_time::microsec_clock::local_time() - start).total_microseconds();
+  
+  // reported at most once a minute while the queue is backing up
+  size_t depth = Depth();
+  if (depth >= maximumBatch && 
+      (lastDepthReport.is_not_a_date_time() || 
+       start - lastDepthReport >= boost::posix_time::minutes(1)))
+  {
+    logs::Database("Write queue backing up, %1% writes queued, last flush took %2%ms",
+                   depth, flushLatency / 1000);
+    lastDepthReport = start;
+  }
+}
+
+void WriteQueue::Run()
+{
+  util::SetProcessTitle("DB WRITER");
+
+  {
+    std::ifstream in(JournalPath(), std::ios::binary);
+    if (in) journaled = 1;
+  }
+
+  try
+  {
+    while (true)
+    {
+      auto batch = Take(true);
+      if (!batch.empty() || journaled) Flush(batch);
+      boost::this_thread::interruption_point();
+    }
+  }
+  catch (const boost::thread_interrupted&)
+  {
+  }
+
+  while (true)
+  {
+    auto batch = Take(false);
+    if (batch.empty()) break;
+    Flush(batch);
+  }
+}
+
+void WriteQueue::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting database writer thread..");
+  thread = boost::thread(&WriteQueue::Run, this);
+}
+
+void WriteQueue::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping database writer thread..");
+    thread.interrupt();
+    thread.join();
+  }
+}
+
+} /* db namespace */
@@ -0,0 +1,110 @@
+#ifndef __DB_WRITEQUEUE_HPP
+#define __DB_WRITEQUEUE_HPP
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <mongo/client/dbclient.h>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace db
+{
+
+class Connection;
+
+// Fire and forget writes are queued here and written by a single
+// background thread, consecutive inserts into the same collection are
+// sent as one batch. When the database is unreachable, or the connection
+// fails while a batch is written, the batch spills to a journal in the
+// datapath which is replayed on reconnection. Writes are sent at least
+// once, a batch or replay cut short by a failed connection is sent again
+// in full, so only idempotent writes may be queued. Inserts are given an
+// _id when they have none and copies already written are rejected as
+// duplicates. Updates must set fields rather than increment them, such
+// writes need to be made directly on a connection instead.
+
+class WriteQueue
+{
+  enum class Type : int
+  {
+    Insert,
+    Update,
+    Remove
+  };
+
+  struct Operation
+  {
+    Type type;
+    std::string collection;
+    mongo::BSONObj query;
+    mongo::BSONObj obj;
+    bool upsert;
+
+    Operation(Type type, const std::string& collection, const mongo::BSONObj& query,
+              const mongo::BSONObj& obj, bool upsert) :
+      type(type), collection(collection), query(query), obj(obj), upsert(upsert) { }
+
+    size_t Size() const
+    { return collection.size() + query.objsize() + obj.objsize(); }
+  };
+
+  mutable std::mutex mutex;
+  std::condition_variable pushed;
+  std::condition_variable popped;
+  std::deque<Operation> queue;
+  size_t queueBytes;
+
+  boost::thread thread;
+  std::atomic<long long> flushLatency;
+  std::atomic<long long> journaled;
+  boost::posix_time::ptime lastFailure;
+  boost::posix_time::ptime lastDepthReport;
+
+  static std::unique_ptr<WriteQueue> instance;
+  static const size_t maximumBytes = 16 * 1024 * 1024;
+  static const size_t maximumBatch = 1000;
+  static const int waitInterval = 100; // milliseconds
+  static const int retryInterval = 15; // seconds
+
+  WriteQueue() : queueBytes(0), flushLatency(0), journaled(0) { }
+
+  void Push(Operation&& op);
+  std::vector<Operation> Take(bool wait);
+  void Flush(const std::vector<Operation>& batch);
+  void Execute(Connection& conn, const std::vector<Operation>& batch);
+  bool Commit(Connection& conn, const std::vector<Operation>& batch);
+  void Spill(const std::vector<Operation>& batch);
+  bool Replay(Connection& conn);
+  std::string JournalPath() const;
+  void Run();
+
+public:
+  void Start();
+  void Stop();
+
+  void Insert(const std::string& collection, const mongo::BSONObj& obj);
+  
+  // obj must not use $inc, see above
+  void Update(const std::string& collection, const mongo::Query& query,
+              const mongo::BSONObj& obj, bool upsert = false);
+  void Remove(const std::string& collection, const mongo::Query& query);
+
+  // reported by SITE METRICS
+  size_t Depth() const;
+  long long FlushLatency() const { return flushLatency; } // microseconds
+  long long Journaled() const { return journaled; }
+
+  static WriteQueue& Get()
+  {
+    if (!instance) instance.reset(new WriteQueue());
+    return *instance;
+  }
+};
+
+} /* db namespace */
+
+#endif
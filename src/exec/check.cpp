@@ -18,7 +18,7 @@ LookupCheck(const std::vector<cfg::CheckScript>& checks, const fs::VirtualPath&
 {
   for (const auto& check : checks)
   {
-    if (util::WildcardMatch(check.Mask(), path.ToString()))
+    if (check.IsMatch(path.ToString()))
     {
       if (check.Disabled()) break;
       return boost::optional<const fs::Path>(check.Path());
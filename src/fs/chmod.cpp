@@ -9,6 +9,8 @@
 #include "acl/path.hpp"
 #include "cfg/get.hpp"
 #include "fs/path.hpp"
+#include "fs/dircache.hpp"
+#include "fs/dirhandle.hpp"
 
 namespace fs
 {
@@ -17,11 +19,15 @@ util::Error Chmod(const RealPath& path, const Mode& mode)
 {
   try
   {
+    DirHandle dir(path.Dirname());
+    std::string name(path.Basename().ToString());
+    
     mode_t newMode;
-    mode.Apply(util::path::Status(path.ToString()).Native().st_mode, umask(0), newMode);
+    mode.Apply(dir.Status(name).Native().st_mode, umask(0), newMode);
   
-    if (chmod(MakeReal(path).CString(), newMode) < 0)
-      return util::Error::Failure(errno);
+    util::Error e = dir.Chmod(name, newMode);
+    if (!e) return e;
+    ListingChanged(path);
   }
   catch (const util::SystemError& e)
   { return util::Error::Failure(e.Errno()); }
@@ -40,7 +46,11 @@ util::Error Chmod(const acl::User& user, const VirtualPath& path, const Mode& mo
   
   try
   {
-    util::path::Status status(MakeReal(path).ToString());
+    RealPath real(MakeReal(path));
+    DirHandle dir(real.Dirname());
+    std::string name(real.Basename().ToString());
+    
+    util::path::Status status(dir.Status(name));
     if (status.IsDirectory())
     {
       util::Error e = PP::DirAllowed<PP::View>(user, path);
@@ -50,8 +60,9 @@ util::Error Chmod(const acl::User& user, const VirtualPath& path, const Mode& mo
     mode_t newMode;
     mode.Apply(status.Native().st_mode, userMask, newMode);
     
-    if (chmod(MakeReal(path).CString(), newMode) < 0)
-      return util::Error::Failure(errno);
+    e = dir.Chmod(name, newMode);
+    if (!e) return e;
+    ListingChanged(real);
   }
   catch (const util::SystemError& e)
   {
@@ -0,0 +1,448 @@
+#include <cstring>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <boost/thread/thread.hpp>
+#include "fs/dircache.hpp"
+#include "fs/owner.hpp"
+#include "util/error.hpp"
+#include "cfg/get.hpp"
+
+namespace fs
+{
+
+namespace
+{
+
+const size_t maxCacheBytes = 64 * 1024 * 1024;
+const size_t maxListingBytes = maxCacheBytes / 8;
+const time_t settleSeconds = 2;
+const size_t parallelThreshold = 2048;
+const size_t slotsPerClaim = 256;
+const unsigned maxWorkers = 4;
+const size_t nameOverhead = sizeof(std::string) + 3 * sizeof(void*); // per name set entry
+
+struct Stamp
+{
+  dev_t dev;
+  ino_t ino;
+  struct timespec mtime;
+  struct timespec ctime;
+
+  Stamp(const struct stat& st) :
+    dev(st.st_dev),
+    ino(st.st_ino)
+  {
+#if defined(__FreeBSD__)
+    mtime = st.st_mtimespec;
+    ctime = st.st_ctimespec;
+#else
+    mtime = st.st_mtim;
+    ctime = st.st_ctim;
+#endif
+  }
+
+  bool operator==(const Stamp& rhs) const
+  {
+    return dev == rhs.dev && ino == rhs.ino &&
+           mtime.tv_sec == rhs.mtime.tv_sec && mtime.tv_nsec == rhs.mtime.tv_nsec &&
+           ctime.tv_sec == rhs.ctime.tv_sec && ctime.tv_nsec == rhs.ctime.tv_nsec;
+  }
+};
+
+// path keyed LRU of values that are valid while the directory's stamp is
+// unchanged, bounded by the caller's estimate of each value's size
+
+template <typename ValueType>
+class StampedCache
+{
+  struct Cached
+  {
+    Stamp stamp;
+    std::shared_ptr<const ValueType> value;
+    size_t bytes;
+    std::list<std::string>::iterator recent;
+
+    Cached(const Stamp& stamp, const std::shared_ptr<const ValueType>& value, size_t bytes) :
+      stamp(stamp), value(value), bytes(bytes) { }
+  };
+
+  typedef std::unordered_map<std::string, Cached> CacheMap;
+
+  CacheMap cache;
+  std::list<std::string> recent; // most recently used first
+  size_t bytes;
+
+  void Erase(typename CacheMap::iterator it)
+  {
+    bytes -= it->second.bytes;
+    recent.erase(it->second.recent);
+    cache.erase(it);
+  }
+
+public:
+  StampedCache() : bytes(0) { }
+
+  std::shared_ptr<const ValueType> Find(const std::string& path, const Stamp& stamp)
+  {
+    auto it = cache.find(path);
+    if (it == cache.end()) return nullptr;
+    if (!(it->second.stamp == stamp))
+    {
+      Erase(it);
+      return nullptr;
+    }
+
+    recent.splice(recent.begin(), recent, it->second.recent);
+    return it->second.value;
+  }
+
+  void Insert(const std::string& path, const Stamp& stamp,
+              const std::shared_ptr<const ValueType>& value, 
+              size_t valueBytes, size_t maxBytes)
+  {
+    Erase(path);
+    while (!recent.empty() && bytes + valueBytes > maxBytes)
+    {
+      Erase(cache.find(recent.back()));
+    }
+
+    auto it = cache.insert(std::make_pair(path, Cached(stamp, value, valueBytes))).first;
+    recent.push_front(path);
+    it->second.recent = recent.begin();
+    bytes += valueBytes;
+  }
+
+  void Erase(const std::string& path)
+  {
+    auto it = cache.find(path);
+    if (it != cache.end()) Erase(it);
+  }
+
+  size_t Bytes() const { return bytes; }
+};
+
+std::mutex mutex;
+StampedCache<DirListing> listings;
+StampedCache<NameSet> nameSets;
+unsigned long long generation = 0;
+std::unordered_map<std::string, unsigned> uploading; // directory, open uploads
+std::atomic<unsigned long long> hits(0);
+std::atomic<unsigned long long> misses(0);
+
+size_t ListingBytes(const DirListing& listing)
+{
+  return sizeof(DirListing) + listing.names.Bytes() +
+         listing.entries.capacity() * sizeof(DirEntry);
+}
+
+// entry metadata is read relative to the directory descriptor, large
+// directories spread the stat and xattr calls over a few threads
+
+struct Slot
+{
+  std::string name;
+  mode_t type;
+  bool okay;
+  bool statted;
+  util::path::Status status;
+  Owner owner;
+
+  Slot(const char* name, mode_t type) :
+    name(name), type(type), okay(false), statted(false), owner(0, 0) { }
+};
+
+// symlinks are left unknown as listings treat links to directories as directories
+mode_t TypeFromDirent(unsigned char type)
+{
+  switch (type)
+  {
+    case DT_DIR   : return S_IFDIR;
+    case DT_REG   : return S_IFREG;
+    case DT_FIFO  : return S_IFIFO;
+    case DT_SOCK  : return S_IFSOCK;
+    case DT_CHR   : return S_IFCHR;
+    case DT_BLK   : return S_IFBLK;
+    default       : return 0;
+  }
+}
+
+void LoadSlots(int dirfd, const RealPath& path, std::vector<Slot>& slots, 
+               bool loadOwners, bool loadStatus, std::atomic<size_t>& next)
+{
+  while (true)
+  {
+    size_t begin = next.fetch_add(slotsPerClaim);
+    if (begin >= slots.size()) break;
+    size_t end = std::min(begin + slotsPerClaim, slots.size());
+    for (size_t i = begin; i < end; ++i)
+    {
+      Slot& slot = slots[i];
+      try
+      {
+        fs::RealPath entryPath(path / slot.name);
+        if (loadStatus || !slot.type)
+        {
+          slot.status = util::path::Status(dirfd, slot.name, entryPath.ToString());
+          slot.statted = true;
+        }
+        if (loadOwners) slot.owner = GetOwner(dirfd, entryPath);
+        slot.okay = true;
+      }
+      catch (const util::SystemError&)
+      {
+      }
+    }
+  }
+}
+
+std::shared_ptr<DirListing> Enumerate(const RealPath& path, bool loadOwners, 
+                                      bool loadStatus, time_t& newest)
+{
+  DIR* dp = opendir(path.CString());
+  if (!dp) throw util::SystemError(errno);
+  std::shared_ptr<DIR> dpGuard(dp, closedir);
+
+  std::vector<Slot> slots;
+  struct dirent de;
+  struct dirent* dep;
+  while (true)
+  {
+    readdir_r(dp, &de, &dep);
+    if (!dep) break;
+
+    if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) continue;
+    slots.emplace_back(de.d_name, TypeFromDirent(de.d_type));
+  }
+
+  std::atomic<size_t> next(0);
+  unsigned workers = std::min(maxWorkers, boost::thread::hardware_concurrency());
+  if (slots.size() >= parallelThreshold && workers > 1 && (loadStatus || loadOwners))
+  {
+    // workers use slots and the directory descriptor so must be joined
+    // before leaving, a kick is held off until they have been
+    {
+      boost::this_thread::disable_interruption noInterrupt;
+      boost::thread_group threads;
+      try
+      {
+        for (unsigned i = 1; i < workers; ++i)
+        {
+          threads.create_thread([&]() { LoadSlots(dirfd(dp), path, slots, loadOwners, loadStatus, next); });
+        }
+        LoadSlots(dirfd(dp), path, slots, loadOwners, loadStatus, next);
+      }
+      catch (...)
+      {
+        next = slots.size();
+        threads.join_all();
+        throw;
+      }
+      threads.join_all();
+    }
+    boost::this_thread::interruption_point();
+  }
+  else
+  {
+    LoadSlots(dirfd(dp), path, slots, loadOwners, loadStatus, next);
+  }
+
+  auto listing = std::make_shared<DirListing>();
+  listing->ownersLoaded = loadOwners;
+  listing->statusLoaded = loadStatus;
+  listing->entries.reserve(slots.size());
+  for (const auto& slot : slots)
+  {
+    if (!slot.okay) continue;
+    const char* name = listing->names.Add(slot.name);
+    if (slot.statted)
+    {
+      const util::path::Status& status = slot.status;
+      listing->totalBytes += status.Size();
+      newest = std::max(newest, std::max(status.Native().st_mtime, status.Native().st_ctime));
+      listing->entries.emplace_back(name, EntryStatus(status), slot.owner);
+    }
+    else
+    {
+      listing->entries.emplace_back(name, EntryStatus(slot.type), slot.owner);
+    }
+  }
+
+  if (!loadStatus) listing->totalBytes = 0;
+  return listing;
+}
+
+}
+
+const char* NameArena::Add(const std::string& name)
+{
+  size_t len = name.size() + 1;
+  if (used + len > blockSize)
+  {
+    size_t size = len > blockSize ? len : blockSize;
+    blocks.emplace_back(new char[size]);
+    bytes += size;
+    used = 0;
+  }
+  
+  char* dest = blocks.back().get() + used;
+  memcpy(dest, name.c_str(), len);
+  used += len;
+  return dest;
+}
+
+std::shared_ptr<const DirListing> ReadListing(const RealPath& path, bool loadOwners, bool loadStatus)
+{
+  struct stat st;
+  if (stat(path.CString(), &st) < 0) throw util::SystemError(errno);
+  Stamp stamp(st);
+
+  unsigned long long startGeneration;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!uploading.count(path.ToString()))
+    {
+      auto cached = listings.Find(path.ToString(), stamp);
+      if (cached && (cached->ownersLoaded || !loadOwners) &&
+          (cached->statusLoaded || !loadStatus))
+      {
+        ++hits;
+        return cached;
+      }
+    }
+    startGeneration = generation;
+  }
+
+  ++misses;
+  time_t newest = std::max(st.st_mtime, st.st_ctime);
+  std::shared_ptr<const DirListing> listing(Enumerate(path, loadOwners, loadStatus, newest));
+
+  size_t bytes = ListingBytes(*listing);
+  if (newest + settleSeconds < std::time(nullptr) && bytes <= maxListingBytes)
+  {
+    // a change made while enumerating may not be reflected in the listing,
+    // an upload started since has already bumped the generation
+    std::lock_guard<std::mutex> lock(mutex);
+    if (generation == startGeneration) 
+      listings.Insert(path.ToString(), stamp, listing, bytes, maxCacheBytes);
+  }
+
+  return listing;
+}
+
+std::shared_ptr<const NameSet> ReadNames(const RealPath& path)
+{
+  struct stat st;
+  if (stat(path.CString(), &st) < 0) throw util::SystemError(errno);
+  Stamp stamp(st);
+
+  unsigned long long startGeneration;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto cached = nameSets.Find(path.ToString(), stamp);
+    if (cached) return cached;
+    startGeneration = generation;
+  }
+
+  DIR* dp = opendir(path.CString());
+  if (!dp) throw util::SystemError(errno);
+  std::shared_ptr<DIR> dpGuard(dp, closedir);
+
+  auto names = std::make_shared<NameSet>();
+  size_t bytes = sizeof(NameSet);
+  struct dirent de;
+  struct dirent* dep;
+  while (true)
+  {
+    readdir_r(dp, &de, &dep);
+    if (!dep) break;
+
+    if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) continue;
+    names->emplace(de.d_name);
+    bytes += nameOverhead + strlen(de.d_name);
+  }
+  bytes += names->bucket_count() * sizeof(void*);
+
+  // the directory's own timestamps are all that validate a name set, so
+  // recently changed directories are left until their timestamps settle
+  size_t maxBytes = cfg::Get().DupeCacheSize() * 1024;
+  if (std::max(st.st_mtime, st.st_ctime) + settleSeconds < std::time(nullptr) && 
+      bytes <= maxBytes / 8)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (generation == startGeneration) 
+      nameSets.Insert(path.ToString(), stamp, names, bytes, maxBytes);
+  }
+
+  return names;
+}
+
+bool CachedNameExists(const DirHandle& dir, const std::string& name)
+{
+  struct stat st;
+  if (fstat(dir.FD(), &st) < 0) return false;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto names = nameSets.Find(dir.Path().ToString(), Stamp(st));
+  return names && names->count(name);
+}
+
+namespace
+{
+
+void EraseChanged(const RealPath& path)
+{
+  ++generation;
+
+  listings.Erase(path.ToString());
+  listings.Erase(path.Dirname().ToString());
+  nameSets.Erase(path.ToString());
+  nameSets.Erase(path.Dirname().ToString());
+}
+
+}
+
+void ListingChanged(const RealPath& path)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  EraseChanged(path);
+}
+
+ActiveUpload::ActiveUpload(const RealPath& path) :
+  path(path)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  ++uploading[path.Dirname().ToString()];
+  EraseChanged(path);
+}
+
+ActiveUpload::~ActiveUpload()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = uploading.find(path.Dirname().ToString());
+  if (it != uploading.end() && !--it->second) uploading.erase(it);
+  EraseChanged(path);
+}
+
+unsigned long long ListingCacheHits()
+{
+  return hits;
+}
+
+unsigned long long ListingCacheMisses()
+{
+  return misses;
+}
+
+size_t ListingCacheBytes()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return listings.Bytes();
+}
+
+} /* fs namespace */
@@ -0,0 +1,93 @@
+#ifndef __FS_DIRCACHE_HPP
+#define __FS_DIRCACHE_HPP
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <unordered_set>
+#include "fs/path.hpp"
+#include "fs/direnumerator.hpp"
+#include "fs/dirhandle.hpp"
+
+namespace fs
+{
+
+// names are packed into large blocks so entries only hold a pointer
+
+class NameArena
+{
+  static const size_t blockSize = 16384;
+  
+  std::vector<std::unique_ptr<char[]>> blocks;
+  size_t used;
+  size_t bytes;
+  
+public:
+  NameArena() : used(blockSize), bytes(0) { }
+  NameArena(const NameArena&) = delete;
+  NameArena& operator=(const NameArena&) = delete;
+  
+  const char* Add(const std::string& name);
+  size_t Bytes() const { return bytes; }
+};
+
+// Unfiltered contents of a directory in readdir order, owners are left
+// as 0,0 when they weren't loaded and entries that weren't stat'd only
+// have their file type.
+
+struct DirListing
+{
+  NameArena names;
+  std::vector<DirEntry> entries;
+  unsigned long long totalBytes;
+  bool ownersLoaded;
+  bool statusLoaded;
+
+  DirListing() : totalBytes(0), ownersLoaded(false), statusLoaded(false) { }
+};
+
+// Listings are shared between sessions while the directory's mtime and
+// ctime are unchanged. Directories with entries modified in the last few
+// seconds aren't cached as they are likely still being written to, nor
+// are directories with a file open for upload by this server.
+std::shared_ptr<const DirListing> ReadListing(const RealPath& path, bool loadOwners,
+                                              bool loadStatus = true);
+
+typedef std::unordered_set<std::string> NameSet;
+
+// Names in a directory for dupe checks, shared while the directory's mtime
+// and ctime are unchanged. Least recently used sets are evicted once they
+// total more than dupe_cache_size.
+std::shared_ptr<const NameSet> ReadNames(const RealPath& path);
+
+// answered from cached name sets only, false when the name isn't there or
+// its directory isn't cached
+bool CachedNameExists(const DirHandle& dir, const std::string& name);
+
+// drops the cached listings and name sets of path and the directory containing it
+void ListingChanged(const RealPath& path);
+
+// Marks a file as open for upload. Writes change its size without touching
+// the directory, so its directory's listings bypass the cache until the
+// upload is finished.
+
+class ActiveUpload
+{
+  RealPath path;
+  
+public:
+  explicit ActiveUpload(const RealPath& path);
+  ~ActiveUpload();
+  
+  ActiveUpload(const ActiveUpload&) = delete;
+  ActiveUpload& operator=(const ActiveUpload&) = delete;
+};
+
+// reported by SITE METRICS
+unsigned long long ListingCacheHits();
+unsigned long long ListingCacheMisses();
+size_t ListingCacheBytes();
+
+} /* fs namespace */
+
+#endif
@@ -1,11 +1,19 @@
 #include <sys/stat.h>
 #include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
 #include <cassert>
+#include <memory>
+#include <vector>
 #include <boost/thread/tss.hpp>
 #include "fs/directory.hpp"
 #include "util/path/status.hpp"
 #include "acl/user.hpp"
 #include "fs/owner.hpp"
+#include "fs/dircache.hpp"
+#include "fs/dirhandle.hpp"
 #include "fs/direnumerator.hpp"
 #include "acl/path.hpp"
 #include "cfg/get.hpp"
@@ -14,6 +22,7 @@
 #include "fs/path.hpp"
 #include "util/error.hpp"
 #include "util/string.hpp"
+#include "logs/logs.hpp"
 
 namespace PP = acl::path;
 
@@ -119,6 +128,8 @@ util::Error ChangeCdpath(const acl::User& user, const fs::Path& path, VirtualPat
 util::Error CreateDirectory(const RealPath& path)
 {
   if (mkdir(MakeReal(path).CString(), 0777) < 0) return util::Error::Failure(errno);
+  PathsChanged();
+  ListingChanged(path);
   return util::Error::Success();
 }
 
@@ -127,49 +138,102 @@ util::Error CreateDirectory(const acl::User& user, const VirtualPath& path)
   util::Error e(PP::DirAllowed<PP::Makedir>(user, path));
   if (!e) return e;
 
-  e = CreateDirectory(MakeReal(path));  
-  if (e) SetOwner(MakeReal(path), Owner(user.ID(), user.PrimaryGID()));
-  return e;
+  try
+  {
+    RealPath real(MakeReal(path));
+    DirHandle dir(real.Dirname());
+    if (mkdirat(dir.FD(), real.Basename().CString(), 0777) < 0) 
+      return util::Error::Failure(errno);
+    PathsChanged();
+    ListingChanged(real);
+    dir.SetOwner(real.Basename().ToString(), Owner(user.ID(), user.PrimaryGID()));
+  }
+  catch (const util::SystemError& e)
+  {
+    return util::Error::Failure(e.Errno());
+  }
+  
+  return util::Error::Success();
 }
 
 util::Error RemoveDirectory(const RealPath& path)
 {
   if (rmdir(MakeReal(path).CString()) < 0) return util::Error::Failure(errno);
+  OwnershipChanged();
+  PathsChanged();
+  ListingChanged(path);
   return util::Error::Success();
 }
 
-util::Error RemoveDirectory(const acl::User& user, const VirtualPath& path)
+util::Error RemoveDirectory(int dirfd, const RealPath& path)
 {
-  util::Error e(PP::DirAllowed<PP::Delete>(user, path));
-  if (!e) return e;
-  
-  try
+  const char* name = path.Basename().CString();
+  if (unlinkat(dirfd, name, AT_REMOVEDIR) < 0)
   {
-    util::path::DirContainer dirCont(MakeReal(path).ToString());
-    for (auto& name : dirCont)
+    if (errno != ENOTEMPTY && errno != EEXIST) return util::Error::Failure(errno);
+    
+    int fd = openat(dirfd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0) return util::Error::Failure(errno);
+    DIR* dp = fdopendir(fd);
+    if (!dp)
     {
-      if (name[0] !=  '.') return util::Error::Failure(ENOTEMPTY);
-        
-      util::path::Status status((MakeReal(path) / name).ToString());
-      if (status.IsDirectory() ||
-          !status.IsWriteable())
-        return util::Error::Failure(ENOTEMPTY);
+      close(fd);
+      return util::Error::Failure(errno);
     }
+    std::shared_ptr<DIR> dpGuard(dp, closedir);
     
+    std::vector<std::string> names;
+    struct dirent de;
+    struct dirent* dep;
+    try
+    {
+      while (true)
+      {
+        readdir_r(dp, &de, &dep);
+        if (!dep) break;
+        if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) continue;
+        if (de.d_name[0] != '.') return util::Error::Failure(ENOTEMPTY);
+        
+        util::path::Status status(fd, de.d_name, (path / de.d_name).ToString());
+        if (status.IsDirectory() || !status.IsWriteable())
+          return util::Error::Failure(ENOTEMPTY);
+        names.emplace_back(de.d_name);
+      }
+    }
+    catch (const util::SystemError& e)
+    {
+      return util::Error::Failure(e.Errno());
+    }
     
-    for (auto& name : dirCont)
+    for (const auto& name : names)
     {
-      RealPath entryPath(MakeReal(path) / name);
-      if (unlink(entryPath.CString()) < 0)
-        return util::Error::Failure(errno);
+      if (unlinkat(fd, name.c_str(), 0) < 0) return util::Error::Failure(errno);
     }
+    
+    if (unlinkat(dirfd, name, AT_REMOVEDIR) < 0) return util::Error::Failure(errno);
+  }
+  
+  OwnershipChanged();
+  PathsChanged();
+  ListingChanged(path);
+  return util::Error::Success();
+}
+
+util::Error RemoveDirectory(const acl::User& user, const VirtualPath& path)
+{
+  util::Error e(PP::DirAllowed<PP::Delete>(user, path));
+  if (!e) return e;
+  
+  try
+  {
+    RealPath real(MakeReal(path));
+    DirHandle dir(real.Dirname());
+    return RemoveDirectory(dir.FD(), real);
   }
   catch (const util::SystemError& e)
   {
     return util::Error::Failure(e.Errno());
   }
-    
-  return RemoveDirectory(MakeReal(path));
 }
 
 util::Error RenameDirectory(const RealPath& oldPath, const RealPath& newPath)
@@ -177,6 +241,10 @@ util::Error RenameDirectory(const RealPath& oldPath, const RealPath& newPath)
   if (rename(oldPath.CString(), newPath.CString()) < 0) 
     return util::Error::Failure(errno);
     
+  OwnershipChanged();
+  PathsChanged();
+  ListingChanged(oldPath);
+  ListingChanged(newPath);
   return util::Error::Success();
 }
 
@@ -194,36 +262,93 @@ util::Error RenameDirectory(const acl::User& user, const VirtualPath& oldPath,
 
 util::Error DirectorySize(const RealPath& path, int depth, long long& kBytes)
 {
-  kBytes = 0;
-  if (depth < 0) return util::Error::Failure(EINVAL);
-  if (depth == 0) return util::Error::Success();
+  int files;
+  return DirectorySize(path, depth, kBytes, files);
+}
+
+namespace
+{
+
+void DirectorySize(const DirHandle& dir, int depth, long long& kBytes, int& files)
+{
+  std::vector<std::string> names;
+  {
+    int fd = dup(dir.FD());
+    if (fd < 0) throw util::SystemError(errno);
+    DIR* dp = fdopendir(fd);
+    if (!dp)
+    {
+      close(fd);
+      throw util::SystemError(errno);
+    }
+    std::shared_ptr<DIR> dpGuard(dp, closedir);
+    
+    struct dirent de;
+    struct dirent* dep;
+    while (true)
+    {
+      readdir_r(dp, &de, &dep);
+      if (!dep) break;
+      if (strcmp(de.d_name, ".") && strcmp(de.d_name, "..")) 
+        names.emplace_back(de.d_name);
+    }
+  }
   
-  try
+  for (const auto& name : names)
   {
-    for (auto& entry : util::path::DirContainer(path.ToString()))
+    try
     {
-      try
+      util::path::Status status(dir.Status(name));
+      if (status.IsDirectory())
       {
-        auto entryPath = path / entry;
-        util::path::Status status(entryPath.ToString());
-        if (status.IsDirectory())
+        if (!status.IsSymLink() && depth > 1)
         {
-          if (!status.IsSymLink())
+          long long subKBytes = 0;
+          int subFiles = 0;
+          try
+          {
+            DirHandle subdir(dir.Entry(name));
+            DirectorySize(subdir, depth - 1, subKBytes, subFiles);
+            kBytes += subKBytes;
+            files += subFiles;
+          }
+          catch (const util::SystemError&)
           {
-            long long subKBytes;
-            if (DirectorySize(entryPath, depth - 1, subKBytes))
-              kBytes += subKBytes;
           }
-        }
-        else
-        if (status.IsRegularFile())
-        {
-          kBytes += status.Size() / 1024;
         }
       }
-      catch (const util::SystemError& e)
-      { std::cout << (path / entry) << " " << e.Message() << std::endl; }
+      else
+      if (status.IsRegularFile())
+      {
+        kBytes += status.Size() / 1024;
+        ++files;
+      }
     }
+    catch (const util::SystemError& e)
+    {
+      // entries removed while being counted are expected
+      if (e.Errno() != ENOENT)
+      {
+        logs::Error("Error while calculating directory size: %1%: %2%", 
+                    dir.Entry(name).ToString(), e.Message());
+      }
+    }
+  }
+}
+
+}
+
+util::Error DirectorySize(const RealPath& path, int depth, long long& kBytes, int& files)
+{
+  kBytes = 0;
+  files = 0;
+  if (depth < 0) return util::Error::Failure(EINVAL);
+  if (depth == 0) return util::Error::Success();
+  
+  try
+  {
+    DirHandle dir(path);
+    DirectorySize(dir, depth, kBytes, files);
   }
   catch (const util::SystemError& e)
   {
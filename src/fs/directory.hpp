@@ -24,6 +24,9 @@ util::Error CreateDirectry(const RealPath& path);
 util::Error CreateDirectory(const acl::User& user, const VirtualPath& path);
 
 util::Error RemoveDirectory(const RealPath& path);
+// dirfd is an open descriptor for the directory containing path, dot
+// files left in the directory are removed as with the user variant below
+util::Error RemoveDirectory(int dirfd, const RealPath& path);
 util::Error RemoveDirectory(const acl::User& user, const VirtualPath& path);
 
 util::Error RenameDirectory(const RealPath& oldPath, const RealPath& newPath);
@@ -36,6 +39,7 @@ util::Error ChangeCdpath(const acl::User& user, const Path& path, VirtualPath& m
 util::Error ChangeDirectory(const acl::User& user, const VirtualPath& path);
 
 util::Error DirectorySize(const RealPath& path, int depth, long long& kBytes);
+util::Error DirectorySize(const RealPath& path, int depth, long long& kBytes, int& files);
 
 const VirtualPath& WorkDirectory();
 void SetWorkDirectory(const VirtualPath& path);
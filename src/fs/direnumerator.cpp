@@ -1,8 +1,7 @@
 #include <cassert>
 #include <memory>
-#include <cstring>
-#include <dirent.h>
 #include "fs/direnumerator.hpp"
+#include "fs/dircache.hpp"
 #include "acl/user.hpp"
 #include "acl/path.hpp"
 #include "cfg/config.hpp"
@@ -15,40 +14,47 @@ namespace fs
 DirEnumerator::DirEnumerator() :
   user(nullptr),
   totalBytes(0),
-  loadOwners(true)
+  loadOwners(true),
+  loadStatus(true)
 {
 }
 
-DirEnumerator::DirEnumerator(const fs::Path& path, bool loadOwners) :
+DirEnumerator::DirEnumerator(const fs::Path& path, bool loadOwners, bool loadStatus) :
   user(nullptr),
   path(path),
   totalBytes(0),
-  loadOwners(loadOwners)
+  loadOwners(loadOwners),
+  loadStatus(loadStatus)
 {
   Readdir();
 }
 
-DirEnumerator::DirEnumerator(const acl::User& user, const fs::VirtualPath& path, bool loadOwners) :
+DirEnumerator::DirEnumerator(const acl::User& user, const fs::VirtualPath& path, 
+                             bool loadOwners, bool loadStatus) :
   user(&user),
   path(MakeReal(path)),
   totalBytes(0),
-  loadOwners(loadOwners)
+  loadOwners(loadOwners),
+  loadStatus(loadStatus)
 {
   Readdir();
 }
 
-void DirEnumerator::Readdir(const fs::Path& path, bool loadOwners)
+void DirEnumerator::Readdir(const fs::Path& path, bool loadOwners, bool loadStatus)
 {
   this->path = RealPath(path);
   this->loadOwners = loadOwners;
+  this->loadStatus = loadStatus;
   Readdir();
 }
 
-void DirEnumerator::Readdir(const acl::User& user, const fs::VirtualPath& path, bool loadOwners)
+void DirEnumerator::Readdir(const acl::User& user, const fs::VirtualPath& path, 
+                            bool loadOwners, bool loadStatus)
 {
   this->user  = &user;
   this->path = MakeReal(path);
   this->loadOwners = loadOwners;
+  this->loadStatus = loadStatus;
   Readdir();
 }
 
@@ -61,56 +67,36 @@ void DirEnumerator::Readdir()
     return;
   }
 
-  DIR* dp = opendir(path.CString());
-  if (!dp) throw util::SystemError(errno);
-  std::shared_ptr<DIR> dpGuard(dp, closedir);
-  
-  struct dirent de;
-  struct dirent* dep;
-  while (true)
-  {
-    readdir_r(dp, &de, &dep);
-    if (!dep) break;
-
-     if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) continue;
-
-    fs::RealPath entryPath(path / de.d_name);
+  auto listing = ReadListing(path, loadOwners, loadStatus);
+  listings.emplace_back(listing);
+  totalBytes += listing->totalBytes;
 
-    try
+  for (const auto& de : listing->entries)
+  {
+    Owner owner(0, 0);
+    if (user)
     {
-      util::path::Status status(entryPath.ToString());
-      totalBytes += status.Size();
-      
-      if (user)
+      fs::VirtualPath virtPath(MakeVirtual(fs::RealPath(path / de.Path())));
+      util::Error hideOwner;
+      if (de.Status().IsDirectory())
       {
-        fs::VirtualPath virtPath(MakeVirtual(entryPath));
-        util::Error hideOwner;
-        if (status.IsDirectory())
-        {
-          if (!PP::DirAllowed<PP::View>(*user, virtPath)) continue;
-          hideOwner = PP::DirAllowed<PP::Hideowner>(*user, virtPath);
-        }
-        else
-        {
-          if (!PP::FileAllowed<PP::View>(*user, virtPath)) continue;
-          hideOwner = PP::FileAllowed<PP::Hideowner>(*user, virtPath);
-        }
-        
-        Owner owner(0, 0);
-        if (!hideOwner && loadOwners) owner = GetOwner(entryPath);
-        entries.emplace_back(fs::Path(de.d_name), status, owner);
+        if (!PP::DirAllowed<PP::View>(*user, virtPath)) continue;
+        if (loadOwners) hideOwner = PP::DirAllowed<PP::Hideowner>(*user, virtPath);
       }
       else
       {
-        Owner owner(0, 0);
-        if (loadOwners) owner = GetOwner(entryPath);
-        entries.emplace_back(fs::Path(de.d_name), status, owner);
+        if (!PP::FileAllowed<PP::View>(*user, virtPath)) continue;
+        if (loadOwners) hideOwner = PP::FileAllowed<PP::Hideowner>(*user, virtPath);
       }
+      
+      if (!hideOwner && loadOwners) owner = de.Owner();
     }
-    catch (const util::SystemError&)
+    else if (loadOwners)
     {
-      continue;
+      owner = de.Owner();
     }
+    
+    entries.emplace_back(de.Name(), de.Status(), owner);
   }
 }
 
@@ -3,6 +3,10 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <ctime>
+#include <strings.h>
+#include <sys/stat.h>
 #include "fs/path.hpp"
 #include "util/path/status.hpp"
 #include "fs/owner.hpp"
@@ -15,19 +19,59 @@ class User;
 namespace fs
 {
 
+struct DirListing;
+
+// the stat fields used by listings
+
+class EntryStatus
+{
+  mode_t mode;
+  nlink_t links;
+  off_t size;
+  time_t modTime;
+  time_t changeTime;
+  bool linkDirectory;
+  
+public:
+  explicit EntryStatus(const util::path::Status& status) :
+    mode(status.Native().st_mode),
+    links(status.Native().st_nlink),
+    size(status.Size()),
+    modTime(status.Native().st_mtime),
+    changeTime(status.Native().st_ctime),
+    linkDirectory(status.IsDirectory() && !S_ISDIR(status.Native().st_mode))
+  { }
+  
+  // file type only, for entries that weren't stat'd
+  explicit EntryStatus(mode_t type) :
+    mode(type), links(0), size(0), modTime(0), changeTime(0), linkDirectory(false)
+  { }
+  
+  bool IsDirectory() const { return S_ISDIR(mode) || linkDirectory; }
+  bool IsSymLink() const { return S_ISLNK(mode); }
+  
+  mode_t Mode() const { return mode; }
+  nlink_t Links() const { return links; }
+  off_t Size() const { return size; }
+  time_t ModTime() const { return modTime; }
+  time_t ChangeTime() const { return changeTime; }
+};
+
 class DirEntry
 {
-  fs::Path path;
-  util::path::Status status;
+  const char* name;
+  EntryStatus status;
   fs::Owner owner;
   
 public:  
-  explicit DirEntry(const fs::Path& path, const util::path::Status& status,
+  // name must outlive the entry, normally it's held by the listing's name arena
+  explicit DirEntry(const char* name, const EntryStatus& status,
                     const fs::Owner& owner) :
-    path(path), status(status), owner(owner) { }
+    name(name), status(status), owner(owner) { }
 
-  const fs::Path& Path() const { return path; }
-  const util::path::Status& Status() const { return status; }
+  const char* Name() const { return name; }
+  fs::Path Path() const { return fs::Path(name); }
+  const EntryStatus& Status() const { return status; }
   const fs::Owner& Owner() const { return owner; }
 };
 
@@ -37,8 +81,10 @@ class DirEnumerator
   fs::RealPath path;
   unsigned long long totalBytes;
   bool loadOwners;
+  bool loadStatus;
   
   std::vector<DirEntry> entries;
+  std::vector<std::shared_ptr<const DirListing>> listings;
   
   void Readdir();
   
@@ -48,11 +94,17 @@ public:
   typedef std::vector<DirEntry>::size_type size_type;
 
   explicit DirEnumerator();
-  explicit DirEnumerator(const fs::Path& path, bool loadOwners = true);
-  explicit DirEnumerator(const acl::User& user, const fs::VirtualPath& path, bool loadOwners = true);
+  explicit DirEnumerator(const fs::Path& path, bool loadOwners = true, 
+                         bool loadStatus = true);
+  explicit DirEnumerator(const acl::User& user, const fs::VirtualPath& path, 
+                         bool loadOwners = true, bool loadStatus = true);
   
-  void Readdir(const fs::Path& path, bool loadOwners = true);
-  void Readdir(const acl::User& user, const fs::VirtualPath& path, bool loadOwners = true);
+  // without loadStatus only the file type of each entry is known and
+  // total bytes is zero, entries are only stat'd when readdir can't
+  // tell their type or they are symlinks
+  void Readdir(const fs::Path& path, bool loadOwners = true, bool loadStatus = true);
+  void Readdir(const acl::User& user, const fs::VirtualPath& path, 
+               bool loadOwners = true, bool loadStatus = true);
 
   uintmax_t TotalBytes() const { return totalBytes; }
   
@@ -67,13 +119,13 @@ public:
 struct DirEntryPathLess
 {
   bool operator()(const DirEntry& de1, const DirEntry& de2)
-  { return de1.Path() < de2.Path(); }  
+  { return strcasecmp(de1.Name(), de2.Name()) < 0; }  
 };
 
 struct DirEntryPathGreater
 {
   bool operator()(const DirEntry& de1, const DirEntry& de2)
-  { return de1.Path() > de2.Path(); }  
+  { return strcasecmp(de1.Name(), de2.Name()) > 0; }  
 };
 
 struct DirEntrySizeLess
@@ -91,13 +143,13 @@ struct DirEntrySizeGreater
 struct DirEntryModTimeLess
 {
   bool operator()(const DirEntry& de1, const DirEntry& de2)
-  { return de1.Status().Native().st_mtime < de2.Status().Native().st_mtime; }  
+  { return de1.Status().ModTime() < de2.Status().ModTime(); }  
 };
 
 struct DirEntryModTimeGreater
 {
   bool operator()(const DirEntry& de1, const DirEntry& de2)
-  { return de1.Status().Native().st_mtime > de2.Status().Native().st_mtime; }  
+  { return de1.Status().ModTime() > de2.Status().ModTime(); }  
 };
 
 } /* fs namespace */
@@ -0,0 +1,82 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include "fs/dirhandle.hpp"
+#include "util/error.hpp"
+
+namespace fs
+{
+
+DirHandle::DirHandle(const RealPath& path) :
+  path(path),
+  fd(open(path.CString(), O_RDONLY | O_DIRECTORY | O_CLOEXEC))
+{
+  if (fd < 0) throw util::SystemError(errno);
+}
+
+DirHandle::~DirHandle()
+{
+  close(fd);
+}
+
+util::path::Status DirHandle::Status(const std::string& name) const
+{
+  return util::path::Status(fd, name, Entry(name).ToString());
+}
+
+int DirHandle::Open(const std::string& name, int flags, mode_t mode) const
+{
+  // never inherited by scripts the server forks
+  int entryFd = openat(fd, name.c_str(), flags | O_CLOEXEC, mode);
+  if (entryFd < 0) throw util::SystemError(errno);
+  return entryFd;
+}
+
+util::Error DirHandle::Unlink(const std::string& name) const
+{
+  if (unlinkat(fd, name.c_str(), 0) < 0) return util::Error::Failure(errno);
+  return util::Error::Success();
+}
+
+util::Error DirHandle::RemoveDirectory(const std::string& name) const
+{
+  if (unlinkat(fd, name.c_str(), AT_REMOVEDIR) < 0) return util::Error::Failure(errno);
+  return util::Error::Success();
+}
+
+util::Error DirHandle::Rename(const std::string& name, const DirHandle& to,
+                              const std::string& toName) const
+{
+  if (renameat(fd, name.c_str(), to.fd, toName.c_str()) < 0)
+    return util::Error::Failure(errno);
+  return util::Error::Success();
+}
+
+util::Error DirHandle::Chmod(const std::string& name, mode_t mode) const
+{
+  if (fchmodat(fd, name.c_str(), mode, 0) < 0) return util::Error::Failure(errno);
+  return util::Error::Success();
+}
+
+Owner DirHandle::GetOwner(const std::string& name) const
+{
+  return fs::GetOwner(fd, Entry(name));
+}
+
+util::Error DirHandle::SetOwner(const std::string& name, const Owner& owner) const
+{
+  return fs::SetOwner(fd, Entry(name), owner);
+}
+
+util::Error DirHandle::FreeDiskSpace(unsigned long long& freeBytes) const
+{
+  struct statvfs sfs;
+  if (fstatvfs(fd, &sfs) < 0) return util::Error::Failure(errno);
+
+  freeBytes = sfs.f_bsize * sfs.f_bfree;
+  return util::Error::Success();
+}
+
+} /* fs namespace */
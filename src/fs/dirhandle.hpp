@@ -0,0 +1,57 @@
+#ifndef __FS_DIRHANDLE_HPP
+#define __FS_DIRHANDLE_HPP
+
+#include <string>
+#include <sys/types.h>
+#include "fs/path.hpp"
+#include "fs/owner.hpp"
+#include "util/path/status.hpp"
+
+namespace util
+{
+class Error;
+}
+
+namespace fs
+{
+
+// An open directory that operations on its entries are made relative to,
+// so the directory's path is resolved by the kernel once rather than on
+// every call. Names are single path components within the directory.
+
+class DirHandle
+{
+  RealPath path;
+  int fd;
+
+public:
+  // throws util::SystemError if the directory can't be opened
+  explicit DirHandle(const RealPath& path);
+  ~DirHandle();
+
+  DirHandle(const DirHandle&) = delete;
+  DirHandle& operator=(const DirHandle&) = delete;
+
+  int FD() const { return fd; }
+  const RealPath& Path() const { return path; }
+  RealPath Entry(const std::string& name) const { return path / name; }
+
+  // throws util::SystemError on failure
+  util::path::Status Status(const std::string& name) const;
+  int Open(const std::string& name, int flags, mode_t mode = 0) const;
+
+  util::Error Unlink(const std::string& name) const;
+  util::Error RemoveDirectory(const std::string& name) const;
+  util::Error Rename(const std::string& name, const DirHandle& to,
+                     const std::string& toName) const;
+  util::Error Chmod(const std::string& name, mode_t mode) const;
+
+  Owner GetOwner(const std::string& name) const;
+  util::Error SetOwner(const std::string& name, const Owner& owner) const;
+
+  util::Error FreeDiskSpace(unsigned long long& freeBytes) const;
+};
+
+} /* fs namespace */
+
+#endif
@@ -6,6 +6,9 @@
 #include "acl/user.hpp"
 #include "fs/path.hpp"
 #include "fs/owner.hpp"
+#include "fs/dircache.hpp"
+#include "fs/dirhandle.hpp"
+#include "fs/freespace.hpp"
 #include "util/misc.hpp"
 #include "acl/path.hpp"
 #include "cfg/config.hpp"
@@ -23,6 +26,19 @@ namespace fs
 util::Error DeleteFile(const RealPath& path)
 {
   if (unlink(path.CString()) < 0) return util::Error::Failure(errno);
+  OwnershipChanged();
+  PathsChanged();
+  ListingChanged(path);
+  return util::Error::Success();
+}
+
+util::Error DeleteFile(int dirfd, const RealPath& path)
+{
+  if (unlinkat(dirfd, path.Basename().CString(), 0) < 0) 
+    return util::Error::Failure(errno);
+  OwnershipChanged();
+  PathsChanged();
+  ListingChanged(path);
   return util::Error::Success();
 }
 
@@ -32,27 +48,31 @@ util::Error DeleteFile(const acl::User& user, const VirtualPath& path,
   util::Error e = PP::FileAllowed<PP::Delete>(user, path);
   if (!e) return e;
   
-  if (size)
+  RealPath real(MakeReal(path));
+  if (!size) return DeleteFile(real);
+
+  try
   {
-    try
-    {
-      util::path::Status status(MakeReal(path).ToString());
-      *size = status.Size();
-      *modTime = status.Native().st_mtime;
-    }
-    catch (const util::SystemError& e)
-    {
-      return util::Error::Failure(e.Errno());
-    }
+    DirHandle dir(real.Dirname());
+    util::path::Status status(dir.Status(real.Basename().ToString()));
+    *size = status.Size();
+    *modTime = status.Native().st_mtime;
+    return DeleteFile(dir.FD(), real);
+  }
+  catch (const util::SystemError& e)
+  {
+    return util::Error::Failure(e.Errno());
   }
-
-  return DeleteFile(MakeReal(path));
 }
 
 util::Error RenameFile(const RealPath& oldPath, const RealPath& newPath)
 {
   if (rename(oldPath.CString(), newPath.CString()) < 0) 
     return util::Error::Failure(errno);
+  OwnershipChanged();
+  PathsChanged();
+  ListingChanged(oldPath);
+  ListingChanged(newPath);
   return util::Error::Success();
 }
 
@@ -68,62 +88,67 @@ util::Error RenameFile(const acl::User& user, const VirtualPath& oldPath,
   return RenameFile(MakeReal(oldPath), MakeReal(newPath));
 }
 
-FileSinkPtr CreateFile(const acl::User& user, const VirtualPath& path)
+FileSinkPtr CreateFile(const acl::User& user, const VirtualPath& path,
+                       SpaceReservation& reservation)
 {
   util::Error e(PP::FileAllowed<PP::Upload>(user, path));
   if (!e) throw util::SystemError(e.Errno());
   
-  unsigned long long freeBytes;
-  e = util::path::FreeDiskSpace(MakeReal(path).Dirname().ToString(), freeBytes);
-  if (!e) throw util::SystemError(e.Errno());
+  RealPath real(MakeReal(path));
+  DirHandle dir(real.Dirname());
+  std::string name(real.Basename().ToString());
   
-  if (static_cast<unsigned long long>(cfg::Get().FreeSpace()) > freeBytes / 1024)
-    throw util::SystemError(ENOSPC);
+  // racing uploads of a file that's already there are turned away
+  // without touching the disk when its directory is cached
+  if (CachedNameExists(dir, name) && !PP::FileAllowed<PP::Overwrite>(user, path))
+    throw util::SystemError(EEXIST);
+  
+  unsigned long long minimum = static_cast<unsigned long long>(cfg::Get().FreeSpace()) * 1024;
+  e = FreeSpaceMonitor::Get().Reserve(dir, minimum, reservation);
+  if (!e) throw util::SystemError(e.Errno());
 
   mode_t mode = cfg::Get().DlIncomplete() ? 0755 : 0644;
     
-  int fd = open(MakeReal(path).CString(), O_CREAT | O_WRONLY | O_EXCL, mode);
-  if (fd < 0)
+  int fd;
+  try
+  {
+    fd = dir.Open(name, O_CREAT | O_WRONLY | O_EXCL, mode);
+  }
+  catch (const util::SystemError& e)
   {
-    if (errno != EEXIST) throw util::SystemError(errno);
+    if (e.Errno() != EEXIST) throw;
 
-    e = PP::FileAllowed<PP::Overwrite>(user, path);
-    if (!e) throw util::SystemError(EEXIST);
+    if (!PP::FileAllowed<PP::Overwrite>(user, path)) throw util::SystemError(EEXIST);
     
-    fd = open(MakeReal(path).CString(), O_WRONLY | O_TRUNC);
-    if (fd < 0) throw util::SystemError(errno);
+    fd = dir.Open(name, O_WRONLY | O_TRUNC);
   }
 
-  SetOwner(MakeReal(path), Owner(user.ID(), user.PrimaryGID()));
+  auto fout = std::make_shared<FileSink>(fd, boost::iostreams::close_handle);
+  ListingChanged(real);
+
+  SetFileOwner(fd, real, Owner(user.ID(), user.PrimaryGID()));
 
-  return std::make_shared<FileSink>(fd, boost::iostreams::close_handle);
+  return fout;
 }
 
-FileSinkPtr AppendFile(const acl::User& user, const VirtualPath& path, off_t offset)
+FileSinkPtr AppendFile(const acl::User& user, const VirtualPath& path, off_t offset,
+                       SpaceReservation& reservation)
 {
   util::Error e = PP::FileAllowed<PP::Resume>(user, path);
   if (!e) throw util::SystemError(e.Errno());
 
-  auto real = MakeReal(path);
-  try
-  {
-    if (!util::path::Status(real.ToString()).IsRegularFile())
-      throw util::RuntimeError("Not a regular file");
-  }
-  catch (const util::SystemError& e)
-  {
-    throw util::SystemError(e.Errno());
-  }
+  RealPath real(MakeReal(path));
+  DirHandle dir(real.Dirname());
+  std::string name(real.Basename().ToString());
+  if (!dir.Status(name).IsRegularFile())
+    throw util::RuntimeError("Not a regular file");
 
-  unsigned long long freeBytes;
-  e = util::path::FreeDiskSpace(real.Dirname().ToString(), freeBytes);
+  unsigned long long minimum = static_cast<unsigned long long>(cfg::Get().FreeSpace()) * 1024;
+  e = FreeSpaceMonitor::Get().Reserve(dir, minimum, reservation);
   if (!e) throw util::SystemError(e.Errno());
-  
-  if (static_cast<unsigned long long>(cfg::Get().FreeSpace()) > freeBytes / 1024)
-    throw util::SystemError(ENOSPC);
 
-  int fd = open(real.CString(), O_WRONLY | O_APPEND);
-  if (fd < 0) throw util::SystemError(errno);
+  int fd = dir.Open(name, O_WRONLY | O_APPEND);
+  ListingChanged(real);
  
   auto fout = std::make_shared<FileSink>(fd, boost::iostreams::close_handle);
 
@@ -147,20 +172,21 @@ FileSourcePtr OpenFile(const acl::User& user, const VirtualPath& path)
   util::Error e = PP::FileAllowed<PP::Download>(user, path);
   if (!e) throw util::SystemError(e.Errno());
   
-  auto real = MakeReal(path);
-  try
-  {
-    if (!util::path::Status(real.ToString()).IsRegularFile())
-      throw util::RuntimeError("Not a regular file");
-  }
-  catch (const util::SystemError& e)
-  {
-    throw util::SystemError(e.Errno());
-  }
-
-  int fd = open(real.CString(), O_RDONLY);
+  // checked on the open descriptor so the path is only resolved once,
+  // non blocking so opening a fifo can't stall before it's rejected
+  int fd = open(MakeReal(path).CString(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
   if (fd < 0) throw util::SystemError(errno);
-  return std::make_shared<FileSource>(fd, boost::iostreams::close_handle);
+  auto fin = std::make_shared<FileSource>(fd, boost::iostreams::close_handle);
+  
+  struct stat st;
+  if (fstat(fd, &st) < 0) throw util::SystemError(errno);
+  if (!S_ISREG(st.st_mode)) throw util::RuntimeError("Not a regular file");
+  
+  int flags = fcntl(fd, F_GETFL);
+  if (flags < 0 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0)
+    throw util::SystemError(errno);
+  
+  return fin;
 }
 
 util::Error UniqueFile(const acl::User& user, const VirtualPath& path, 
@@ -21,6 +21,7 @@ namespace fs
 
 class RealPath;
 class VirtualPath;
+class SpaceReservation;
 
 typedef boost::iostreams::file_descriptor_sink FileSink;        
 typedef std::shared_ptr<FileSink> FileSinkPtr;
@@ -28,6 +29,8 @@ typedef boost::iostreams::file_descriptor_source FileSource;
 typedef std::shared_ptr<FileSource> FileSourcePtr;
 
 util::Error DeleteFile(const RealPath& path);
+// dirfd is an open descriptor for the directory containing path
+util::Error DeleteFile(int dirfd, const RealPath& path);
 util::Error DeleteFile(const acl::User& user, const VirtualPath& path, 
                        off_t* size = nullptr, time_t* modTime = nullptr);
 
@@ -35,8 +38,11 @@ util::Error RenameFile(const RealPath& oldPath, const RealPath& newPath);
 util::Error RenameFile(const acl::User& user, const VirtualPath& oldPath,
                        const VirtualPath& newPath);
 
-FileSinkPtr CreateFile(const acl::User& user, const VirtualPath& path);
-FileSinkPtr AppendFile(const acl::User& user, const VirtualPath& path, off_t offset);
+// the upload's space on disk is reserved until reservation is destroyed
+FileSinkPtr CreateFile(const acl::User& user, const VirtualPath& path,
+                       SpaceReservation& reservation);
+FileSinkPtr AppendFile(const acl::User& user, const VirtualPath& path, off_t offset,
+                       SpaceReservation& reservation);
 FileSourcePtr OpenFile(const acl::User& user, const VirtualPath& path);
 util::Error UniqueFile(const acl::User& user, const VirtualPath& path, 
                        size_t filenameLength, VirtualPath& uniquePath);
@@ -0,0 +1,218 @@
+#include <cerrno>
+#include <vector>
+#include <cstring>
+#include <sys/stat.h>
+#if defined(__linux__)
+# include <mntent.h>
+#endif
+#include "fs/freespace.hpp"
+#include "fs/dirhandle.hpp"
+#include "fs/path.hpp"
+#include "util/path/status.hpp"
+#include "util/error.hpp"
+#include "util/verify.hpp"
+#include "util/misc.hpp"
+#include "cfg/get.hpp"
+#include "logs/logs.hpp"
+
+namespace fs
+{
+
+namespace
+{
+
+// the path itself and any filesystems mounted below it
+std::vector<std::string> MountsUnder(const std::string& path)
+{
+  std::vector<std::string> mounts { path };
+#if defined(__linux__)
+  FILE* fp = setmntent("/proc/self/mounts", "r");
+  if (!fp) return mounts;
+  
+  std::string prefix(path.back() == '/' ? path : path + "/");
+  struct mntent ent;
+  char buf[4096];
+  while (getmntent_r(fp, &ent, buf, sizeof(buf)))
+  {
+    if (!strncmp(ent.mnt_dir, prefix.c_str(), prefix.length()))
+      mounts.emplace_back(ent.mnt_dir);
+  }
+  endmntent(fp);
+#endif
+  return mounts;
+}
+
+}
+
+std::unique_ptr<FreeSpaceMonitor> FreeSpaceMonitor::instance;
+
+unsigned long long FreeSpaceMonitor::Estimate(const Filesystem& filesystem)
+{
+  // reserved is read before written, a reservation used by a write in
+  // between is counted twice rather than not at all
+  unsigned long long used = filesystem.counters->reserved;
+  used += filesystem.counters->written - filesystem.writtenAtSample;
+  return used < filesystem.freeBytes ? filesystem.freeBytes - used : 0;
+}
+
+util::Error FreeSpaceMonitor::Available(dev_t dev, const std::string& path,
+    const std::function<util::Error(unsigned long long&)>& sample,
+    unsigned long long& freeBytes)
+{
+  if (running)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = filesystems.find(dev);
+    if (it != filesystems.end())
+    {
+      freeBytes = Estimate(it->second);
+      return util::Error::Success();
+    }
+  }
+
+  util::Error e = sample(freeBytes);
+  if (!e || !running) return e;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  filesystems.insert(std::make_pair(dev, Filesystem(path, freeBytes)));
+  return util::Error::Success();
+}
+
+util::Error FreeSpaceMonitor::Available(const DirHandle& dir, unsigned long long& freeBytes)
+{
+  struct stat st;
+  if (fstat(dir.FD(), &st) < 0) return util::Error::Failure(errno);
+  return Available(st.st_dev, dir.Path().ToString(), 
+                   [&dir](unsigned long long& freeBytes) { return dir.FreeDiskSpace(freeBytes); },
+                   freeBytes);
+}
+
+util::Error FreeSpaceMonitor::Available(const RealPath& path, unsigned long long& freeBytes)
+{
+  struct stat st;
+  if (stat(path.CString(), &st) < 0) return util::Error::Failure(errno);
+  
+  // a file's directory is kept as the sample path as files come and go
+  std::string dirPath(S_ISDIR(st.st_mode) ? path.ToString() : path.Dirname().ToString());
+  return Available(st.st_dev, dirPath, 
+                   [&dirPath](unsigned long long& freeBytes)
+                   { return util::path::FreeDiskSpace(dirPath, freeBytes); },
+                   freeBytes);
+}
+
+util::Error FreeSpaceMonitor::Reserve(const DirHandle& dir, unsigned long long minimumBytes,
+                                      SpaceReservation& reservation)
+{
+  struct stat st;
+  if (fstat(dir.FD(), &st) < 0) return util::Error::Failure(errno);
+  
+  // samples the filesystem if it hasn't been seen before
+  unsigned long long freeBytes;
+  util::Error e = Available(dir, freeBytes);
+  if (!e) return e;
+  
+  // checked again under the lock so concurrent admissions see each
+  // other's reservations
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = filesystems.find(st.st_dev);
+  if (it != filesystems.end()) freeBytes = Estimate(it->second);
+  if (freeBytes < minimumBytes) return util::Error::Failure(ENOSPC);
+  
+  if (it != filesystems.end())
+  {
+    reservation.counters = it->second.counters;
+    reservation.outstanding = uploadEstimate;
+    it->second.counters->reserved += uploadEstimate;
+  }
+  
+  return util::Error::Success();
+}
+
+std::vector<FreeSpaceMonitor::Usage> FreeSpaceMonitor::Filesystems()
+{
+  std::vector<Usage> usage;
+  std::lock_guard<std::mutex> lock(mutex);
+  for (const auto& kv : filesystems)
+  {
+    usage.emplace_back(Usage { kv.second.path, Estimate(kv.second), 
+                               kv.second.counters->reserved });
+  }
+  return usage;
+}
+
+void FreeSpaceMonitor::Sample()
+{
+  std::vector<std::pair<dev_t, Filesystem>> samples;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    samples.assign(filesystems.begin(), filesystems.end());
+  }
+  
+  for (auto& sample : samples)
+  {
+    boost::this_thread::interruption_point();
+    
+    // taken before the statvfs call so bytes written during it are still
+    // subtracted, the estimate errs towards less space rather than more
+    unsigned long long written = sample.second.counters->written;
+    unsigned long long freeBytes;
+    util::Error e = util::path::FreeDiskSpace(sample.second.path, freeBytes);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = filesystems.find(sample.first);
+    if (it == filesystems.end()) continue;
+    
+    if (!e)
+    {
+      // sampled again from another path when next used
+      filesystems.erase(it);
+      continue;
+    }
+
+    it->second.freeBytes = freeBytes;
+    it->second.writtenAtSample = written;
+  }
+}
+
+void FreeSpaceMonitor::Run()
+{
+  util::SetProcessTitle("FREE SPACE");
+  try
+  {
+    unsigned long long freeBytes;
+    for (const auto& path : MountsUnder(cfg::Get().Sitepath()))
+    {
+      Available(RealPath(path), freeBytes);
+    }
+    
+    while (true)
+    {
+      boost::this_thread::sleep(boost::posix_time::seconds(cfg::Get().FreeSpaceInterval()));
+      Sample();
+    }
+  }
+  catch (const boost::thread_interrupted&)
+  {
+  }
+}
+
+void FreeSpaceMonitor::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting free space monitor thread..");
+  running = true;
+  thread = boost::thread(&FreeSpaceMonitor::Run, this);
+}
+
+void FreeSpaceMonitor::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping free space monitor thread..");
+    thread.interrupt();
+    thread.join();
+    running = false;
+  }
+}
+
+} /* fs namespace */
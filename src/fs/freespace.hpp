@@ -0,0 +1,140 @@
+#ifndef __FS_FREESPACE_HPP
+#define __FS_FREESPACE_HPP
+
+#include <string>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+#include <boost/thread/thread.hpp>
+
+namespace util
+{
+class Error;
+}
+
+namespace fs
+{
+
+class RealPath;
+class DirHandle;
+class SpaceReservation;
+
+// bytes written by uploads and bytes reserved for uploads in progress
+// that they haven't written yet
+
+struct SpaceCounters
+{
+  std::atomic<unsigned long long> written;
+  std::atomic<unsigned long long> reserved;
+  
+  SpaceCounters() : written(0), reserved(0) { }
+};
+
+// Free space on each filesystem ebftpd has written to is sampled by a
+// background thread every free_space_interval seconds, so slow statvfs
+// calls on network mounts are kept off uploads. Filesystems are sampled
+// directly the first time they are seen. Bytes written by uploads since
+// the last sample and space reserved for uploads in progress are
+// subtracted. Each upload reserves a small fixed estimate when it's
+// admitted, so uploads admitted together can still overcommit if they
+// each write more than that before the next sample.
+
+class FreeSpaceMonitor
+{
+  struct Filesystem
+  {
+    std::string path;
+    unsigned long long freeBytes;
+    unsigned long long writtenAtSample;
+    std::shared_ptr<SpaceCounters> counters;
+
+    Filesystem(const std::string& path, unsigned long long freeBytes) :
+      path(path), freeBytes(freeBytes), writtenAtSample(0),
+      counters(std::make_shared<SpaceCounters>()) { }
+  };
+
+  std::mutex mutex;
+  std::unordered_map<dev_t, Filesystem> filesystems;
+  std::atomic<bool> running;
+  boost::thread thread;
+
+  static std::unique_ptr<FreeSpaceMonitor> instance;
+  static const unsigned long long uploadEstimate = 16 * 1024 * 1024;
+
+  FreeSpaceMonitor() : running(false) { }
+
+  static unsigned long long Estimate(const Filesystem& filesystem);
+  util::Error Available(dev_t dev, const std::string& path,
+                        const std::function<util::Error(unsigned long long&)>& sample,
+                        unsigned long long& freeBytes);
+  void Sample();
+  void Run();
+
+public:
+  void Start();
+  void Stop();
+
+  // estimated free bytes on the filesystem containing the directory
+  util::Error Available(const DirHandle& dir, unsigned long long& freeBytes);
+  util::Error Available(const RealPath& path, unsigned long long& freeBytes);
+
+  // admits an upload to the filesystem containing the directory when at
+  // least minimumBytes are estimated free, then reserves the upload
+  // estimate for it. Fails with ENOSPC when there isn't enough space.
+  util::Error Reserve(const DirHandle& dir, unsigned long long minimumBytes,
+                      SpaceReservation& reservation);
+
+  struct Usage
+  {
+    std::string path;
+    unsigned long long freeBytes;
+    unsigned long long reservedBytes;
+  };
+  
+  // reported by SITE METRICS
+  std::vector<Usage> Filesystems();
+
+  static FreeSpaceMonitor& Get()
+  {
+    if (!instance) instance.reset(new FreeSpaceMonitor());
+    return *instance;
+  }
+};
+
+// Space held for an upload from its admission until it finishes. Bytes
+// the upload writes are taken from the reservation first and accounted
+// against the free space sampled for its filesystem until the next sample
+// picks them up, what's left of the reservation is released on destruction.
+
+class SpaceReservation
+{
+  std::shared_ptr<SpaceCounters> counters;
+  unsigned long long outstanding;
+  
+  friend class FreeSpaceMonitor;
+  
+public:
+  SpaceReservation() : outstanding(0) { }
+  ~SpaceReservation() { if (counters) counters->reserved -= outstanding; }
+  
+  SpaceReservation(const SpaceReservation&) = delete;
+  SpaceReservation& operator=(const SpaceReservation&) = delete;
+
+  void Written(unsigned long long bytes)
+  {
+    if (!counters) return;
+    // added to written before leaving reserved so an estimate never misses them
+    counters->written += bytes;
+    unsigned long long used = bytes < outstanding ? bytes : outstanding;
+    counters->reserved -= used;
+    outstanding -= used;
+  }
+};
+
+} /* fs namespace */
+
+#endif
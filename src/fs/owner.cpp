@@ -1,12 +1,19 @@
 #include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
 
 #if defined(__FreeBSD__)
 # include <sys/extattr.h>
+// extattr has no create only mode, the flag is accepted and ignored
+# define XATTR_CREATE 0x1
 #else
 # include <sys/xattr.h>
 #endif
 
 #include "fs/owner.hpp"
+#include "fs/dircache.hpp"
+#include "cfg/get.hpp"
 #include "util/error.hpp"
 #include "logs/logs.hpp"
 
@@ -37,84 +44,243 @@ ssize_t getxattr(const char *path, const char *name, void *value, size_t size)
   return extattr_get_file(path, EXTATTR_NAMESPACE_USER, name, value, size);
 }
 
+int removexattr(const char *path, const char *name)
+{
+  return extattr_delete_file(path, EXTATTR_NAMESPACE_USER, name);
+}
+
+int fsetxattr(int fd, const char *name, const void *value, size_t size, int /* flags */)
+{
+  int ret = extattr_set_fd(fd, EXTATTR_NAMESPACE_USER, name, value, size);
+  return ret >= 0 ? 0 : ret;
+}
+
 #endif
 
+const char* ownerAttributeName = "user.ebftpd.owner";
 const char* uidAttributeName = "user.ebftpd.uid";
 const char* gidAttributeName = "user.ebftpd.gid";
 
-int32_t GetAttribute(const std::string& path, const char* attribute)
+// owner attribute is the uid followed by the gid, each 4 bytes little endian
+const size_t ownerAttributeSize = 8;
+
+void Encode(const Owner& owner, unsigned char* buf)
+{
+  uint32_t ids[2] = { static_cast<uint32_t>(owner.UID()), static_cast<uint32_t>(owner.GID()) };
+  for (int i = 0; i < 2; ++i)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      buf[i * 4 + j] = (ids[i] >> (j * 8)) & 0xff;
+    }
+  }
+}
+
+Owner Decode(const unsigned char* buf)
+{
+  uint32_t ids[2] = { 0, 0 };
+  for (int i = 0; i < 2; ++i)
+  {
+    for (int j = 0; j < 4; ++j)
+    {
+      ids[i] |= static_cast<uint32_t>(buf[i * 4 + j]) << (j * 8);
+    }
+  }
+  return Owner(static_cast<int32_t>(ids[0]), static_cast<int32_t>(ids[1]));
+}
+
+bool IgnoreError(int error)
+{
+  return error == ENOATTR || error == ENODATA || error == ENOENT;
+}
+
+// returns false if the attribute isn't set
+bool GetAttribute(const std::string& path, const char* attribute, int32_t& id)
 {
   char buf[11];
-  int len = getxattr(path.c_str(), attribute, buf, sizeof(buf));
+  int len = getxattr(path.c_str(), attribute, buf, sizeof(buf) - 1);
   if (len < 0)
   {
-    if (errno != ENOATTR && errno != ENODATA && errno != ENOENT)
+    if (!IgnoreError(errno))
     {
       logs::Error("Error while reading filesystem attribute %1%: %2%: %3%", 
                   attribute, path, util::Error::Failure(errno).Message());
     }
-    return 0;
+    return false;
   }
   
   buf[len] = '\0';
   
-  int32_t id;
+  id = 0;
   if (sscanf(buf, "%i", &id) != 1)
   {
     logs::Error("Invalid filesystem ownership attribute %1%, resetting to 0: %2%: %3%", 
                 attribute, path, buf);
   }
-  return id;
+  return true;
 }
 
-util::Error SetAttribute(const std::string& path, const char* attribute, int32_t id)
+util::Error SetOwnerAttribute(const std::string& path, const Owner& owner)
 {
-  char buf[11];
-  int len = snprintf(buf, sizeof(buf), "%i", id);
-  if (setxattr(path.c_str(), attribute, buf, len, 0) < 0)
+  unsigned char buf[ownerAttributeSize];
+  Encode(owner, buf);
+  if (setxattr(path.c_str(), ownerAttributeName, buf, sizeof(buf), 0) < 0)
   {
     auto e = util::Error::Failure(errno);
     logs::Error("Error while setting filesystem ownership attribute %1%: %2%: %3%", 
-                attribute, path, e.Message());
+                ownerAttributeName, path, e.Message());
     return e;
   }  
   return util::Error::Success();
 }
 
+// reads the owner attribute, returns false if there isn't a valid one
+bool ReadOwnerAttribute(const std::string& path, Owner& owner)
+{
+  unsigned char buf[ownerAttributeSize];
+  int len = getxattr(path.c_str(), ownerAttributeName, buf, sizeof(buf));
+  if (len < 0)
+  {
+    if (!IgnoreError(errno) && errno != ERANGE)
+    {
+      logs::Error("Error while reading filesystem attribute %1%: %2%: %3%", 
+                  ownerAttributeName, path, util::Error::Failure(errno).Message());
+    }
+    return false;
+  }
+  
+  if (len != static_cast<int>(sizeof(buf)))
+  {
+    logs::Error("Invalid filesystem ownership attribute %1%: %2%", ownerAttributeName, path);
+    return false;
+  }
+  
+  owner = Decode(buf);
+  return true;
+}
+
+// files owned before the single attribute existed have a decimal string
+// attribute each for uid and gid, these are rewritten on first read
+// unless legacy_owner is disabled. Files with neither are unowned and
+// left untouched.
+Owner MigrateOwner(const std::string& path)
+{
+  int32_t uid = 0;
+  int32_t gid = 0;
+  bool legacy = GetAttribute(path, uidAttributeName, uid);
+  if (GetAttribute(path, gidAttributeName, gid)) legacy = true;
+
+  Owner owner(uid, gid);
+  if (!legacy) return owner;
+
+  // an owner set since the attribute was first read takes precedence
+  unsigned char buf[ownerAttributeSize];
+  Encode(owner, buf);
+  if (setxattr(path.c_str(), ownerAttributeName, buf, sizeof(buf), XATTR_CREATE) < 0)
+  {
+    if (errno != EEXIST) return owner;
+    ReadOwnerAttribute(path, owner);
+  }
+  
+  removexattr(path.c_str(), uidAttributeName);
+  removexattr(path.c_str(), gidAttributeName);
+  return owner;
+}
+
+// names the entry through the already open directory's procfs link so
+// only the link and the entry are looked up, not the directory's path.
+// fgetxattr would need each entry opened first, three calls rather than
+// one, which for fifos and devices has side effects of its own.
+std::string RelativePath(int dirfd, const RealPath& path)
+{
+#if defined(__linux__)
+  char fdPath[32];
+  int len = snprintf(fdPath, sizeof(fdPath), "/proc/self/fd/%i/", dirfd);
+  if (len > 0 && len < static_cast<int>(sizeof(fdPath)))
+    return std::string(fdPath, len) + path.Basename().ToString();
+#else
+  (void) dirfd;
+#endif
+  return path.ToString();
+}
+
 }
 
 Owner GetOwner(const std::string& path)
 {
-  return Owner(GetAttribute(path, uidAttributeName),
-               GetAttribute(path, gidAttributeName));
+  Owner owner(0, 0);
+  if (ReadOwnerAttribute(path, owner) || !cfg::Get().LegacyOwner()) return owner;
+  return MigrateOwner(path);
+}
 
+Owner GetOwner(int dirfd, const RealPath& path)
+{
+  return GetOwner(RelativePath(dirfd, path));
+}
+
+namespace
+{
+std::atomic<unsigned long> ownerGeneration(0);
+}
+
+unsigned long OwnerGeneration()
+{
+  return ownerGeneration;
+}
+
+void OwnershipChanged()
+{
+  ++ownerGeneration;
 }
 
 util::Error SetOwner(const std::string& path, const Owner& owner)
 {
-  if (owner.UID() != -1)
-  {
-    auto e = SetAttribute(path, uidAttributeName, owner.UID());
-    if (!e) return e;
-  }
+  OwnershipChanged();
+  if (owner.UID() != -1 && owner.GID() != -1)
+    return SetOwnerAttribute(path, owner);
   
-  if (owner.GID() != -1)
-  {
-    return SetAttribute(path, gidAttributeName, owner.GID());
-  }
+  if (owner.UID() == -1 && owner.GID() == -1)
+    return util::Error::Success();
   
-  return util::Error::Success();
+  Owner current(GetOwner(path));
+  return SetOwnerAttribute(path, Owner(owner.UID() != -1 ? owner.UID() : current.UID(),
+                                       owner.GID() != -1 ? owner.GID() : current.GID()));
 }
 
 Owner GetOwner(const RealPath& path)
 {
   return GetOwner(path.ToString());
-
 }
 
 util::Error SetOwner(const RealPath& path, const Owner& owner)
 {
-  return SetOwner(path.ToString(), owner);
+  util::Error e = SetOwner(path.ToString(), owner);
+  ListingChanged(path);
+  return e;
+}
+
+util::Error SetFileOwner(int fd, const RealPath& path, const Owner& owner)
+{
+  OwnershipChanged();
+  unsigned char buf[ownerAttributeSize];
+  Encode(owner, buf);
+  if (fsetxattr(fd, ownerAttributeName, buf, sizeof(buf), 0) < 0)
+  {
+    auto e = util::Error::Failure(errno);
+    logs::Error("Error while setting filesystem ownership attribute %1%: %2%: %3%", 
+                ownerAttributeName, path.ToString(), e.Message());
+    return e;
+  }
+  
+  ListingChanged(path);
+  return util::Error::Success();
+}
+
+util::Error SetOwner(int dirfd, const RealPath& path, const Owner& owner)
+{
+  util::Error e = SetOwner(RelativePath(dirfd, path), owner);
+  ListingChanged(path);
+  return e;
 }
 
 } /* fs namespace */
@@ -31,6 +31,19 @@ util::Error SetOwner(const std::string& path, const Owner& owner);
 Owner GetOwner(const RealPath& path);
 util::Error SetOwner(const RealPath& path, const Owner& owner);
 
+// dirfd is an open descriptor for the parent directory of path,
+// the lookup is made relative to it where the platform allows
+Owner GetOwner(int dirfd, const RealPath& path);
+util::Error SetOwner(int dirfd, const RealPath& path, const Owner& owner);
+
+// fd is open on the file at path itself, owner must have both ids set
+util::Error SetFileOwner(int fd, const RealPath& path, const Owner& owner);
+
+// incremented whenever the owner at a path may have changed, by a
+// change of owner or by files and directories being moved or removed
+unsigned long OwnerGeneration();
+void OwnershipChanged();
+
 inline std::ostream& operator<<(std::ostream& os, const Owner& owner)
 {
   os << owner.UID() << "," << owner.GID();
@@ -1,5 +1,10 @@
 #include <stdexcept>
+#include <atomic>
+#include <ctime>
+#include <sys/stat.h>
+#include <boost/thread/tss.hpp>
 #include "fs/path.hpp"
+#include "util/lrucache.hpp"
 #include "cfg/get.hpp"
 #include "logs/logs.hpp"
 #include "fs/directory.hpp"
@@ -7,6 +12,82 @@
 namespace fs
 {
 
+namespace
+{
+
+const time_t resolveCacheSeconds = 5;
+std::atomic<unsigned long> pathsGeneration(0);
+
+// symlink free directories for the session on this thread, dropped when
+// ebftpd changes the tree and expired after a few seconds so symlinks
+// changed by other processes are picked up
+
+class ResolveCache
+{
+  unsigned long generation;
+  util::LRUCache<std::string, std::pair<std::string, time_t>> dirs;
+  
+public:
+  ResolveCache() : generation(pathsGeneration), dirs(256) { }
+  
+  bool Lookup(const std::string& dir, std::string& resolved)
+  {
+    if (generation != pathsGeneration)
+    {
+      generation = pathsGeneration;
+      dirs.Clear();
+      return false;
+    }
+    
+    auto entry = dirs.Find(dir);
+    if (!entry || entry->second < std::time(nullptr)) return false;
+    resolved = entry->first;
+    return true;
+  }
+  
+  void Insert(const std::string& dir, const std::string& resolved)
+  {
+    dirs.Insert(dir, std::make_pair(resolved, std::time(nullptr) + resolveCacheSeconds));
+  }
+};
+
+boost::thread_specific_ptr<ResolveCache> resolveCache;
+
+bool ResolveDirectory(const std::string& dir, std::string& resolved)
+{
+  if (!resolveCache.get()) resolveCache.reset(new ResolveCache());
+  if (resolveCache->Lookup(dir, resolved)) return true;
+  if (!util::path::Realpath(dir, resolved)) return false;
+  resolveCache->Insert(dir, resolved);
+  return true;
+}
+
+// same result as realpath falling back to the realpath of the parent for
+// paths that don't exist yet, but with the parent's resolution cached
+// only the last component needs to be checked
+void ResolveSymlinks(std::string& path)
+{
+  std::string dir;
+  if (path == "/" || !ResolveDirectory(util::path::Dirname(path), dir)) return;
+  
+  std::string joined(util::path::Join(dir, util::path::Basename(path)));
+  struct stat st;
+  if (lstat(joined.c_str(), &st) == 0 && S_ISLNK(st.st_mode))
+  {
+    std::string noSymlinks;
+    if (util::path::Realpath(joined, noSymlinks)) joined.swap(noSymlinks);
+  }
+  
+  path.swap(joined);
+}
+
+}
+
+void PathsChanged()
+{
+  ++pathsGeneration;
+}
+
 Path MakeRelative(const VirtualPath& path)
 {
   return Path(util::path::Relative(WorkDirectory().ToString(), path.ToString()));
@@ -69,20 +150,7 @@ const RealPath& MakeReal(const Path& path)
   {
     auto virt = Resolve(WorkDirectory() / path);
     path.cache.real = new RealPath(RealPath(cfg::Get().Sitepath()) & virt);
-    std::string& p = path.cache.real->path;
-    std::string noSymlinks;
-    if (util::path::Realpath(p, noSymlinks))
-    {
-      p = noSymlinks;
-    }
-    else
-    {
-      // deal with paths that don't exist yet
-      if (util::path::Realpath(util::path::Dirname(p), noSymlinks))
-      {
-        p = util::path::Join(noSymlinks, util::path::Basename(p));
-      }
-    }
+    ResolveSymlinks(path.cache.real->path);
   }
   return *path.cache.real;
 }
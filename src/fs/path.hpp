@@ -311,6 +311,10 @@ const RealPath& MakeReal(const RealPath& path);
 
 VirtualPath PathFromUser(const std::string& path);
 
+// drops resolved directories cached by MakeReal, for changes that
+// can alter where a path resolves to
+void PathsChanged();
+
 } /* fs namespace */
 
 #endif
@@ -0,0 +1,251 @@
+#include <cerrno>
+#include <vector>
+#include <unistd.h>
+#include <poll.h>
+#if defined(__linux__)
+# include <sys/inotify.h>
+#endif
+#include "fs/tailwatcher.hpp"
+#include "util/verify.hpp"
+#include "util/misc.hpp"
+#include "util/error.hpp"
+#include "logs/logs.hpp"
+
+namespace fs
+{
+
+std::unique_ptr<TailWatcher> TailWatcher::instance;
+
+void TailWatcher::Notify(Watch& watch, TailEvent event)
+{
+  ++watch.sequence;
+  if (event == TailEvent::Changed) watch.changedSequence = watch.sequence;
+  watch.changed.notify_all();
+}
+
+void TailWatcher::ReadEvents()
+{
+#if defined(__linux__)
+  char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  while (true)
+  {
+    ssize_t len = read(inotifyFd, buf, sizeof(buf));
+    if (len <= 0) break;
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    for (char* p = buf; p < buf + len; )
+    {
+      auto event = reinterpret_cast<const struct inotify_event*>(p);
+      p += sizeof(struct inotify_event) + event->len;
+
+      auto it = descriptors.find(event->wd);
+      if (it == descriptors.end()) continue;
+
+      auto watch = it->second;
+      if (event->mask & IN_IGNORED)
+      {
+        // watch is gone with the file, polling reports whatever follows
+        watch->wd = -1;
+        descriptors.erase(it);
+      }
+
+      Notify(*watch, event->mask == IN_MODIFY ? TailEvent::Grown : TailEvent::Changed);
+    }
+  }
+#endif
+}
+
+void TailWatcher::PollWatches()
+{
+  std::vector<std::shared_ptr<Watch>> polled;
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    for (const auto& kv : watches)
+    {
+      if (kv.second->wd < 0) polled.emplace_back(kv.second);
+    }
+  }
+
+  for (const auto& watch : polled)
+  {
+    struct stat st;
+    bool exists = stat(watch->path.c_str(), &st) == 0;
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    if (!exists)
+    {
+      if (watch->exists) Notify(*watch, TailEvent::Changed);
+      watch->exists = false;
+      continue;
+    }
+
+    if (!watch->exists || st.st_ino != watch->last.st_ino || st.st_mode != watch->last.st_mode)
+      Notify(*watch, TailEvent::Changed);
+    else if (st.st_size != watch->last.st_size)
+      Notify(*watch, TailEvent::Grown);
+
+    watch->exists = true;
+    watch->last = st;
+  }
+}
+
+void TailWatcher::Run()
+{
+  util::SetProcessTitle("TAIL WATCHER");
+  try
+  {
+    while (true)
+    {
+      bool polling = false;
+      {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        for (const auto& kv : watches)
+        {
+          if (kv.second->wd < 0)
+          {
+            polling = true;
+            break;
+          }
+        }
+      }
+
+      int timeout = idleInterval;
+      if (polling) timeout = pollInterval;
+      if (inotifyFd >= 0)
+      {
+        struct pollfd pfd;
+        pfd.fd = inotifyFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) > 0) ReadEvents();
+        boost::this_thread::interruption_point();
+      }
+      else
+        boost::this_thread::sleep(boost::posix_time::milliseconds(timeout));
+
+      if (polling) PollWatches();
+    }
+  }
+  catch (const boost::thread_interrupted&)
+  {
+  }
+}
+
+std::shared_ptr<TailWatcher::Watch> TailWatcher::Add(const RealPath& path)
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  if (!running) return nullptr;
+
+  auto& watch = watches[path.ToString()];
+  if (!watch)
+  {
+    watch = std::make_shared<Watch>(path.ToString());
+    watch->exists = stat(path.CString(), &watch->last) == 0;
+#if defined(__linux__)
+    if (inotifyFd >= 0)
+    {
+      int wd = inotify_add_watch(inotifyFd, path.CString(), IN_MODIFY | IN_ATTRIB | 
+                                 IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF);
+      // another path to the same file already has the descriptor
+      if (wd >= 0 && descriptors.insert(std::make_pair(wd, watch)).second)
+        watch->wd = wd;
+    }
+#endif
+  }
+
+  ++watch->followers;
+  return watch;
+}
+
+void TailWatcher::Remove(const std::shared_ptr<Watch>& watch)
+{
+  boost::lock_guard<boost::mutex> lock(mutex);
+  if (--watch->followers > 0) return;
+
+#if defined(__linux__)
+  if (watch->wd >= 0)
+  {
+    inotify_rm_watch(inotifyFd, watch->wd);
+    descriptors.erase(watch->wd);
+  }
+#endif
+  watches.erase(watch->path);
+}
+
+void TailWatcher::Start()
+{
+  verify(!thread.joinable());
+  logs::Debug("Starting tail watcher thread..");
+
+#if defined(__linux__)
+  inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotifyFd < 0)
+  {
+    logs::Error("Unable to initialise inotify, falling back to polling: %1%", 
+                util::Error::Failure(errno).Message());
+  }
+#endif
+
+  {
+    boost::lock_guard<boost::mutex> lock(mutex);
+    running = true;
+  }
+
+  thread = boost::thread(&TailWatcher::Run, this);
+}
+
+void TailWatcher::Stop()
+{
+  if (thread.joinable())
+  {
+    logs::Debug("Stopping tail watcher thread..");
+    thread.interrupt();
+    thread.join();
+
+    boost::lock_guard<boost::mutex> lock(mutex);
+    running = false;
+    if (inotifyFd >= 0)
+    {
+      close(inotifyFd);
+      inotifyFd = -1;
+    }
+  }
+}
+
+TailFollower::TailFollower(const RealPath& path) :
+  watch(TailWatcher::Get().Add(path))
+{
+}
+
+TailFollower::~TailFollower()
+{
+  if (watch) TailWatcher::Get().Remove(watch);
+}
+
+unsigned long long TailFollower::Sequence()
+{
+  if (!watch) return 0;
+  boost::lock_guard<boost::mutex> lock(TailWatcher::Get().mutex);
+  return watch->sequence;
+}
+
+TailEvent TailFollower::Wait(unsigned long long seen, const boost::posix_time::time_duration& timeout)
+{
+  if (!watch)
+  {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    return TailEvent::Timeout;
+  }
+
+  boost::unique_lock<boost::mutex> lock(TailWatcher::Get().mutex);
+  auto deadline = boost::get_system_time() + timeout;
+  while (watch->sequence == seen)
+  {
+    if (!watch->changed.timed_wait(lock, deadline) && watch->sequence == seen)
+      return TailEvent::Timeout;
+  }
+
+  return watch->changedSequence > seen ? TailEvent::Changed : TailEvent::Grown;
+}
+
+} /* fs namespace */
@@ -0,0 +1,102 @@
+#ifndef __FS_TAILWATCHER_HPP
+#define __FS_TAILWATCHER_HPP
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "fs/path.hpp"
+
+namespace fs
+{
+
+enum class TailEvent
+{
+  Grown,    // only written to since last seen
+  Changed,  // mode changed, closed, moved or removed
+  Timeout
+};
+
+// Downloads following files that are still being uploaded share one watch
+// per file and are woken only when it changes. inotify is used where
+// available, otherwise the watcher thread stats each followed file once
+// per poll interval on behalf of all its followers.
+
+class TailWatcher
+{
+  struct Watch
+  {
+    std::string path;
+    int wd;
+    unsigned followers;
+    unsigned long long sequence;
+    unsigned long long changedSequence;
+    struct stat last;
+    bool exists;
+    boost::condition_variable_any changed;
+
+    Watch(const std::string& path) :
+      path(path), wd(-1), followers(0), sequence(0),
+      changedSequence(0), exists(true) { }
+  };
+
+  boost::mutex mutex;
+  std::unordered_map<std::string, std::shared_ptr<Watch>> watches;
+  std::unordered_map<int, std::shared_ptr<Watch>> descriptors;
+  int inotifyFd;
+  bool running;
+  boost::thread thread;
+
+  static std::unique_ptr<TailWatcher> instance;
+  static const int pollInterval = 50; // milliseconds
+  static const int idleInterval = 500; // milliseconds
+
+  TailWatcher() : inotifyFd(-1), running(false) { }
+
+  void Notify(Watch& watch, TailEvent event);
+  void ReadEvents();
+  void PollWatches();
+  void Run();
+
+  std::shared_ptr<Watch> Add(const RealPath& path);
+  void Remove(const std::shared_ptr<Watch>& watch);
+
+public:
+  void Start();
+  void Stop();
+
+  static TailWatcher& Get()
+  {
+    if (!instance) instance.reset(new TailWatcher());
+    return *instance;
+  }
+
+  friend class TailFollower;
+};
+
+class TailFollower
+{
+  std::shared_ptr<TailWatcher::Watch> watch;
+
+public:
+  explicit TailFollower(const RealPath& path);
+  ~TailFollower();
+
+  TailFollower(const TailFollower&) = delete;
+  TailFollower& operator=(const TailFollower&) = delete;
+
+  // taken before reading so a change made while reading isn't missed
+  unsigned long long Sequence();
+
+  // waits for the file to change after sequence seen or for timeout to
+  // pass, sleeps briefly and times out when the watcher isn't running
+  TailEvent Wait(unsigned long long seen, const boost::posix_time::time_duration& timeout);
+};
+
+} /* fs namespace */
+
+#endif
@@ -0,0 +1,190 @@
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <boost/thread/thread.hpp>
+#include "fs/treewalk.hpp"
+#include "acl/path.hpp"
+#include "util/error.hpp"
+#include "logs/logs.hpp"
+
+namespace fs
+{
+
+namespace
+{
+
+const unsigned maxWorkers = 4;
+
+class Walker
+{
+  const acl::User& user;
+  const WalkVisitor& visit;
+  const WalkErrorHandler& error;
+  std::atomic<unsigned> workers;
+  std::atomic<bool> interrupted;
+
+  bool ClaimWorker()
+  {
+    unsigned current = workers;
+    while (current < maxWorkers)
+    {
+      if (workers.compare_exchange_weak(current, current + 1)) return true;
+    }
+    return false;
+  }
+
+  void Worker(const WalkEntry& directory)
+  {
+    try
+    {
+      Contents(directory);
+    }
+    catch (const std::exception& e)
+    {
+      logs::Error("Error while walking %1%: %2%", directory.path.ToString(), e.what());
+    }
+    --workers;
+  }
+
+public:
+  Walker(const acl::User& user, const WalkVisitor& visit, const WalkErrorHandler& error) :
+    user(user), visit(visit), error(error), workers(1), interrupted(false) { }
+
+  // only the walking client's thread is ever interrupted, workers pick it
+  // up from there
+  bool Interrupted()
+  {
+    if (boost::this_thread::interruption_requested()) interrupted = true;
+    return interrupted;
+  }
+
+  void Contents(const WalkEntry& directory);
+};
+
+void Walker::Contents(const WalkEntry& directory)
+{
+  int fd = openat(directory.dirfd, directory.real.Basename().CString(),
+                  O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+  {
+    error(directory.path, errno);
+    return;
+  }
+
+  DIR* dp = fdopendir(fd);
+  if (!dp)
+  {
+    int errno_ = errno;
+    close(fd);
+    error(directory.path, errno_);
+    return;
+  }
+  std::shared_ptr<DIR> dpGuard(dp, closedir);
+
+  // names are read up front as entries are often removed while walking
+  std::vector<std::string> names;
+  struct dirent de;
+  struct dirent* dep;
+  while (true)
+  {
+    readdir_r(dp, &de, &dep);
+    if (!dep) break;
+
+    if (!strcmp(de.d_name, ".") || !strcmp(de.d_name, "..")) continue;
+    names.emplace_back(de.d_name);
+  }
+
+  std::vector<WalkEntry> subdirs;
+  for (const std::string& name : names)
+  {
+    if (Interrupted()) return;
+
+    VirtualPath path(directory.path / name);
+    if (!acl::path::Allowed<acl::path::View>(user, path)) continue;
+
+    try
+    {
+      RealPath real(directory.real / name);
+      WalkEntry entry(fd, path, real, util::path::Status(fd, name, real.ToString()));
+      if (entry.status.IsDirectory() && !entry.status.IsSymLink())
+        subdirs.emplace_back(entry);
+      else
+        visit(entry);
+    }
+    catch (const util::SystemError& e)
+    {
+      error(path, e.Errno());
+    }
+  }
+
+  // subdirectories are handed to spare workers while there are any,
+  // the rest are walked on this thread. workers use subdirs and fd so are
+  // always joined before leaving, WalkTree holds off interruption so the
+  // joins can't throw
+  boost::thread_group threads;
+  try
+  {
+    for (const auto& subdir : subdirs)
+    {
+      if (Interrupted()) break;
+      if (ClaimWorker())
+        threads.create_thread([this, &subdir]() { Worker(subdir); });
+      else
+        Contents(subdir);
+    }
+  }
+  catch (...)
+  {
+    threads.join_all();
+    throw;
+  }
+  threads.join_all();
+
+  // subdirectories may not have been fully walked
+  if (Interrupted()) return;
+
+  for (const auto& subdir : subdirs)
+  {
+    visit(subdir);
+  }
+}
+
+}
+
+void WalkTree(const acl::User& user, const VirtualPath& path, bool descend,
+              const WalkVisitor& visit, const WalkErrorHandler& error)
+{
+  RealPath real(MakeReal(path));
+  int fd = open(real.Dirname().CString(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    error(path, errno);
+    return;
+  }
+  std::shared_ptr<void> fdGuard(nullptr, [fd](void*) { close(fd); });
+
+  try
+  {
+    std::string name(real.Basename().ToString());
+    WalkEntry entry(fd, path, real, util::path::Status(fd, name, real.ToString()));
+    if (descend && entry.status.IsDirectory() && !entry.status.IsSymLink())
+    {
+      {
+        boost::this_thread::disable_interruption noInterrupt;
+        Walker(user, visit, error).Contents(entry);
+      }
+      boost::this_thread::interruption_point();
+    }
+    visit(entry);
+  }
+  catch (const util::SystemError& e)
+  {
+    error(path, e.Errno());
+  }
+}
+
+} /* fs namespace */
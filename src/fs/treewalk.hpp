@@ -0,0 +1,45 @@
+#ifndef __FS_TREEWALK_HPP
+#define __FS_TREEWALK_HPP
+
+#include <functional>
+#include "fs/path.hpp"
+#include "util/path/status.hpp"
+
+namespace acl
+{
+class User;
+}
+
+namespace fs
+{
+
+// An entry found while walking a tree, dirfd is open on the directory
+// containing it so the entry can be operated on without resolving its
+// full path again. Only valid for the duration of the visit.
+struct WalkEntry
+{
+  int dirfd;
+  VirtualPath path;
+  RealPath real;
+  util::path::Status status;
+
+  WalkEntry(int dirfd, const VirtualPath& path, const RealPath& real,
+            const util::path::Status& status) :
+    dirfd(dirfd), path(path), real(real), status(status) { }
+};
+
+typedef std::function<void(const WalkEntry& entry)> WalkVisitor;
+typedef std::function<void(const VirtualPath& path, int errno_)> WalkErrorHandler;
+
+// Visits path and, when descend is set, everything below it that the user
+// can view, path itself is expected to have been checked by the caller.
+// Directories are visited after their contents so they can be removed once
+// emptied, and symlinked directories aren't descended into. Independent
+// subdirectories are walked in parallel so both functions must be thread
+// safe.
+void WalkTree(const acl::User& user, const VirtualPath& path, bool descend,
+              const WalkVisitor& visit, const WalkErrorHandler& error);
+
+} /* fs namespace */
+
+#endif
@@ -110,6 +110,8 @@ void ClientImpl::SetLoggedIn(bool kicked)
     loggedInAt = boost::posix_time::second_clock::local_time();
   }
 
+  acl::path::BindCache(user->ID());
+
   logs::Event("LOGIN", logs::QuoteOff(), 
               "ident address", Ident(LogAddresses::Normal) + '@' + Hostname(LogAddresses::Normal), 
               "ip", logs::Brackets('(', ')'), IP(LogAddresses::Normal), 
@@ -200,9 +202,7 @@ void ClientImpl::DisplayBanner()
 
 void ClientImpl::IdleReset(std::string commandLine)
 {
-  for (auto & mask : cfg::Get().IdleCommands())
-    if (util::WildcardMatch(mask, commandLine, true))
-      return;
+  if (cfg::Get().IsIdleCommand(commandLine)) return;
   idleTime = boost::posix_time::second_clock::local_time();
   idleExpires = idleTime + idleTimeout;
 }
@@ -298,9 +298,12 @@ bool ClientImpl::ReloadUser()
   
   logs::Debug("Reloaded user profile");
   
-  std::lock_guard<std::mutex> lock(mutex);
-  user = std::move(*optUser);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    user = std::move(*optUser);
+  }
   
+  acl::path::BindCache(user->ID());
   return true;
 }
 
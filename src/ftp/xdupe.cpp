@@ -5,7 +5,8 @@
 #include "ftp/client.hpp"
 #include "ftp/xdupe.hpp"
 #include "logs/logs.hpp"
-#include "fs/dircontainer.hpp"
+#include "fs/dircache.hpp"
+#include "acl/path.hpp"
 
 namespace ftp { namespace xdupe
 {
@@ -116,9 +117,17 @@ std::vector<std::string> BuildDupeList(ftp::Client& client, const fs::VirtualPat
   std::vector<std::string> dupes;
   try
   {
-    for (const std::string& dupe : fs::DirContainer(client.User(), path.Dirname()))
+    fs::VirtualPath dirname(path.Dirname());
+    if (!acl::path::Allowed<acl::path::View>(client.User(), dirname)) return dupes;
+    
+    // only names that will be listed need checking against the user's view
+    for (const std::string& dupe : *fs::ReadNames(fs::MakeReal(dirname)))
     {
-      if (IsXdupe(dupe)) dupes.emplace_back(dupe);
+      if (IsXdupe(dupe) && 
+          acl::path::Allowed<acl::path::View>(client.User(), dirname / dupe))
+      {
+        dupes.emplace_back(dupe);
+      }
     }
   }
   catch (const util::SystemError& e)
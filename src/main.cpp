@@ -29,6 +29,14 @@
 #include "db/initialise.hpp"
 #include "util/scopeguard.hpp"
 #include "db/replicator.hpp"
+#include "db/user/creditledger.hpp"
+#include "db/index/sizeindex.hpp"
+#include "db/index/index.hpp"
+#include "db/dupe/dupe.hpp"
+#include "db/trigramindex.hpp"
+#include "fs/freespace.hpp"
+#include "fs/tailwatcher.hpp"
+#include "db/writequeue.hpp"
 #include "ftp/online.hpp"
 #include "fs/mode.hpp"
 
@@ -242,10 +250,24 @@ int main(int argc, char** argv)
       }
       else if (Daemonise(foreground))
       {
+        db::WriteQueue::Get().Start();
         db::Replicator::Get().Start();
+        db::CreditLedger::Get().Start();
+        db::index::SizeIndex::Get().Start();
+        fs::FreeSpaceMonitor::Get().Start();
+        fs::TailWatcher::Get().Start();
+        db::index::Trigrams()->Start();
+        db::dupe::Trigrams()->Start();
         ftp::Server::Get().StartThread();
         ftp::Server::Get().JoinThread();
+        db::dupe::Trigrams()->Stop();
+        db::index::Trigrams()->Stop();
+        fs::TailWatcher::Get().Stop();
+        fs::FreeSpaceMonitor::Get().Stop();
+        db::index::SizeIndex::Get().Stop();
+        db::CreditLedger::Get().Stop();
         db::Replicator::Get().Stop();
+        db::WriteQueue::Get().Stop();
         ftp::Server::Cleanup();
       }
     }
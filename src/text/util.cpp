@@ -8,6 +8,7 @@
 #include "ftp/client.hpp"
 #include "cfg/get.hpp"
 #include "fs/directory.hpp"
+#include "fs/freespace.hpp"
 #include "db/stats/stats.hpp"
 #include "stats/stat.hpp"
 #include "acl/util.hpp"
@@ -48,7 +49,7 @@ void RegisterGlobals(const ftp::Client& client, TemplateSection& ts)
   ts.RegisterValue("work_dir", workDir.ToString());
   
   unsigned long long freeSpace = -1;
-  (void) util::path::FreeDiskSpace(fs::MakeReal(workDir).ToString(), freeSpace);
+  (void) fs::FreeSpaceMonitor::Get().Available(fs::MakeReal(workDir), freeSpace);
   ts.RegisterSize("free_space", freeSpace);
 
   if (ts.HasTag("section"))
@@ -4,6 +4,7 @@
 #include <cassert>
 #include <iterator>
 #include <cstdint>
+#include <stdexcept>
 #include <unordered_map>
 
 namespace util
@@ -58,6 +59,18 @@ class LRUCache
     entries.erase(it);
   }
   
+  void Touch(Entry* entry)
+  {
+    if (entry == first) return;
+    if (entry->next) entry->next->prev = entry->prev;
+    if (entry->prev) entry->prev->next = entry->next;
+    if (entry == last) last = entry->prev;
+    entry->prev = nullptr;
+    entry->next = first;
+    first->prev = entry;
+    first = entry;
+  }
+  
 public:
   typedef typename std::unordered_map<KeyType, ValueType>::size_type size_type;
 
@@ -150,7 +163,7 @@ public:
   
   const ValueType& Lookup(const KeyType& key) const
   {
-    typename EntriesMap::iterator it = entries.find(key);
+    typename EntriesMap::const_iterator it = entries.find(key);
     if (it == entries.end()) throw std::out_of_range("Key not in cache");
     return it->second->pair.second;
   }
@@ -162,8 +175,24 @@ public:
     return it->second->pair.second;
   }
   
+  // returns nullptr if not in cache, a hit becomes the most recently used
+  ValueType* Find(const KeyType& key)
+  {
+    typename EntriesMap::iterator it = entries.find(key);
+    if (it == entries.end()) return nullptr;
+    Touch(it->second);
+    return &it->second->pair.second;
+  }
+  
   void Insert(const KeyType& key, const ValueType& value)
   {
+    typename EntriesMap::iterator it = entries.find(key);
+    if (it != entries.end())
+    {
+      delete it->second;
+      entries.erase(it);
+    }
+    
     while (entries.size() >= capacity) EraseOldest();
     entries.insert(std::make_pair(key, new Entry(*this, key, value)));
   }
@@ -172,9 +201,21 @@ public:
   {
     typename EntriesMap::iterator it = entries.find(key);
     if (it == entries.end()) throw std::out_of_range("Key not in cache");    
+    delete it->second;
     entries.erase(it);
   }
   
+  void Clear()
+  {
+    while (!entries.empty())
+    {
+      delete entries.begin()->second;
+      entries.erase(entries.begin());
+    }
+  }
+  
+  size_type Size() const { return entries.size(); }
+  
   iterator begin() { return iterator(first); }
   iterator end() { return iterator(nullptr); }
   const_iterator begin() const { return const_iterator(first); }
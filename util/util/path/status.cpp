@@ -1,5 +1,6 @@
 #include <unistd.h>
 #include <cerrno>
+#include <fcntl.h>
 #include <sys/statvfs.h>
 #include "util/path/status.hpp"
 #include "util/error.hpp"
@@ -23,6 +24,27 @@ Status::Status(const std::string& path) :
   Reset();
 }
 
+Status::Status(int dirfd, const std::string& name, const std::string& path) :
+  path(path),
+  linkDirectory(false),
+  linkRegularFile(false),
+  statOkay(false)
+{
+  if (fstatat(dirfd, name.c_str(), &native, AT_SYMLINK_NOFOLLOW) < 0) 
+    throw util::SystemError(errno);
+    
+  if (IsSymLink())
+  {
+    struct stat st;
+    if (fstatat(dirfd, name.c_str(), &st, 0) == 0)
+    {
+      if (S_ISDIR(st.st_mode)) linkDirectory = true;
+      else if (S_ISREG(st.st_mode)) linkRegularFile = true;
+    }
+  }
+  statOkay = true;
+}
+
 Status& Status::Reset()
 {
   if (path.empty()) throw std::logic_error("no path set");
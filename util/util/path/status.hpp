@@ -25,6 +25,8 @@ class Status
 public:
   Status();
   Status(const std::string& path);
+  // stats name relative to an open directory, path is the full path
+  Status(int dirfd, const std::string& name, const std::string& path);
   
   Status& Reset(const std::string& path);
   
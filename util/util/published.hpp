@@ -0,0 +1,64 @@
+#ifndef __UTIL_PUBLISHED_HPP
+#define __UTIL_PUBLISHED_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace util
+{
+
+// Holds an immutable value that writers replace wholesale. Each thread
+// keeps its own reference along with the version it was taken at, so
+// readers only load an atomic counter and bump a reference count, the
+// mutex is taken once per thread after each publish. A thread holds on
+// to the value it last read until it reads again or exits.
+
+template <typename T>
+class Published : boost::noncopyable
+{
+  struct Local
+  {
+    unsigned long long version;
+    std::shared_ptr<const T> value;
+  };
+
+  mutable std::mutex mutex;
+  std::shared_ptr<const T> value;
+  std::atomic<unsigned long long> version;
+  mutable boost::thread_specific_ptr<Local> local;
+
+public:
+  explicit Published(const std::shared_ptr<const T>& value) :
+    value(value), version(1) { }
+
+  std::shared_ptr<const T> Get() const
+  {
+    Local* current = local.get();
+    if (!current || current->version != version.load(std::memory_order_acquire))
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!current)
+      {
+        current = new Local;
+        local.reset(current);
+      }
+      current->version = version.load(std::memory_order_relaxed);
+      current->value = value;
+    }
+    return current->value;
+  }
+
+  void Publish(const std::shared_ptr<const T>& next)
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    value = next;
+    version.fetch_add(1, std::memory_order_release);
+  }
+};
+
+} /* util namespace */
+
+#endif
@@ -0,0 +1,151 @@
+#include <algorithm>
+#include <cctype>
+#include "util/wildcard.hpp"
+#include "util/string.hpp"
+
+namespace util
+{
+
+namespace
+{
+
+inline char Fold(char ch, bool iCase)
+{
+  return iCase ? std::tolower(static_cast<unsigned char>(ch)) : ch;
+}
+
+}
+
+WildcardPattern::WildcardPattern(const std::string& pattern, bool iCase) :
+  pattern(pattern),
+  iCase(iCase),
+  kind(Kind::Literal)
+{
+  std::string::size_type pos = pattern.find_first_of("*?[\\");
+  prefix.assign(pattern, 0, pos);
+  if (iCase) ToLower(prefix);
+
+  if (pos == std::string::npos) return;
+
+  if (pattern.find_first_of("[\\") != std::string::npos)
+  {
+    kind = Kind::Fnmatch;
+    return;
+  }
+
+  // split on * so each segment is literals and ? only, a leading or
+  // trailing * gives an empty first or last segment
+  kind = Kind::Glob;
+  std::string::size_type start = 0;
+  while (true)
+  {
+    std::string::size_type star = pattern.find('*', start);
+    segments.emplace_back(pattern, start, star == std::string::npos ?
+                          std::string::npos : star - start);
+    if (iCase) ToLower(segments.back());
+    if (star == std::string::npos) break;
+    start = star + 1;
+  }
+}
+
+bool WildcardPattern::SegmentAt(const std::string& segment, const std::string& str,
+                                std::string::size_type pos) const
+{
+  for (char ch : segment)
+  {
+    if (ch != '?' && ch != Fold(str[pos], iCase)) return false;
+    ++pos;
+  }
+  return true;
+}
+
+bool WildcardPattern::Match(const std::string& str) const
+{
+  switch (kind)
+  {
+    case Kind::Literal  :
+    {
+      if (str.size() != pattern.size()) return false;
+      return SegmentAt(prefix, str, 0);
+    }
+    case Kind::Fnmatch  :
+    {
+      if (str.size() < prefix.size() || !SegmentAt(prefix, str, 0)) return false;
+      return WildcardMatch(pattern, str, iCase);
+    }
+    case Kind::Glob     :
+      break;
+  }
+
+  const std::string& first = segments.front();
+  if (segments.size() == 1)
+    return str.size() == first.size() && SegmentAt(first, str, 0);
+
+  const std::string& last = segments.back();
+  if (str.size() < first.size() + last.size()) return false;
+  if (!SegmentAt(first, str, 0)) return false;
+  if (!SegmentAt(last, str, str.size() - last.size())) return false;
+
+  // fixed length segments between stars can be matched leftmost first
+  std::string::size_type pos = first.size();
+  std::string::size_type end = str.size() - last.size();
+  for (auto it = segments.begin() + 1; it != segments.end() - 1; ++it)
+  {
+    if (it->empty()) continue;
+    while (true)
+    {
+      if (end - pos < it->size()) return false;
+      if (SegmentAt(*it, str, pos)) break;
+      ++pos;
+    }
+    pos += it->size();
+  }
+
+  return true;
+}
+
+void WildcardList::Add(const std::string& pattern)
+{
+  patterns.emplace_back(pattern, iCase);
+
+  size_t node = 0;
+  for (char ch : patterns.back().Prefix())
+  {
+    auto it = nodes[node].children.find(ch);
+    if (it == nodes[node].children.end())
+    {
+      nodes.emplace_back();
+      it = nodes[node].children.insert(std::make_pair(ch, nodes.size() - 1)).first;
+    }
+    node = it->second;
+  }
+
+  nodes[node].entries.emplace_back(patterns.size() - 1);
+}
+
+size_t WildcardList::Find(const std::string& str) const
+{
+  std::vector<size_t> candidates;
+  size_t node = 0;
+  for (std::string::size_type depth = 0; ; ++depth)
+  {
+    candidates.insert(candidates.end(), nodes[node].entries.begin(),
+                      nodes[node].entries.end());
+    if (depth == str.size()) break;
+
+    auto it = nodes[node].children.find(Fold(str[depth], iCase));
+    if (it == nodes[node].children.end()) break;
+    node = it->second;
+  }
+
+  // earlier patterns take precedence regardless of prefix length
+  std::sort(candidates.begin(), candidates.end());
+  for (size_t index : candidates)
+  {
+    if (patterns[index].Match(str)) return index;
+  }
+
+  return npos;
+}
+
+} /* util namespace */
@@ -0,0 +1,77 @@
+#ifndef __UTIL_WILDCARD_HPP
+#define __UTIL_WILDCARD_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace util
+{
+
+// A wildcard pattern compiled once and matched with the same results as
+// WildcardMatch. Patterns made up of literals, * and ? are matched
+// directly, bracket expressions and escapes are left to fnmatch.
+
+class WildcardPattern
+{
+  enum class Kind : int
+  {
+    Literal,
+    Glob,
+    Fnmatch
+  };
+
+  std::string pattern;
+  bool iCase;
+  Kind kind;
+  std::string prefix;
+  std::vector<std::string> segments;
+
+  bool SegmentAt(const std::string& segment, const std::string& str,
+                 std::string::size_type pos) const;
+
+public:
+  WildcardPattern() : iCase(false), kind(Kind::Literal) { }
+  explicit WildcardPattern(const std::string& pattern, bool iCase = false);
+
+  bool Match(const std::string& str) const;
+
+  const std::string& Pattern() const { return pattern; }
+
+  // literal text every match starts with
+  const std::string& Prefix() const { return prefix; }
+};
+
+// An ordered list of patterns indexed by literal prefix, Find returns the
+// first pattern in insertion order that matches.
+
+class WildcardList
+{
+  struct Node
+  {
+    std::map<char, size_t> children;
+    std::vector<size_t> entries;
+  };
+
+  bool iCase;
+  std::vector<WildcardPattern> patterns;
+  std::vector<Node> nodes;
+
+public:
+  static const size_t npos = static_cast<size_t>(-1);
+
+  explicit WildcardList(bool iCase = false) : iCase(iCase), nodes(1) { }
+
+  void Add(const std::string& pattern);
+
+  size_t Find(const std::string& str) const;
+  bool Match(const std::string& str) const { return Find(str) != npos; }
+
+  const WildcardPattern& operator[](size_t index) const { return patterns[index]; }
+  size_t Size() const { return patterns.size(); }
+  bool Empty() const { return patterns.empty(); }
+};
+
+} /* util namespace */
+
+#endif